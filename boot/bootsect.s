@@ -42,6 +42,10 @@ ENDSEG   = SYSSEG + SYSSIZE		! where to stop loading
 !		0x301 - first partition on first drive etc
 ROOT_DEV = 0x306
 
+! SCHED_MODE:	0 - counter/priority scheduler
+!		1 - fair-share (virtual runtime) scheduler
+SCHED_MODE = 0
+
 entry start
 start:
 	mov	ax,#BOOTSEG
@@ -246,7 +250,9 @@ msg1:
 	.ascii "Loading system ..."
 	.byte 13,10,13,10
 
-.org 508
+.org 506
+sched_mode:
+	.word SCHED_MODE
 root_dev:
 	.word ROOT_DEV
 boot_flag:
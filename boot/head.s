@@ -12,7 +12,7 @@
  * the page directory.
  */
 .text
-.globl _idt,_gdt,_pg_dir,_tmp_floppy_area
+.globl _idt,_gdt,_pg_dir,_tmp_floppy_area,_empty_zero_page
 _pg_dir:
 startup_32:
 	movl $0x10,%eax
@@ -124,6 +124,13 @@ pg2:
 pg3:
 
 .org 0x5000
+/*
+ * empty_zero_page is mapped read-only wherever a task reads memory
+ * it has never written to (see do_no_page()). It has to stay zero.
+ */
+_empty_zero_page:
+
+.org 0x6000
 /*
  * tmp_floppy_area is used by the floppy-driver when DMA cannot
  * reach to a buffer-block. It needs to be aligned, so that it isn't
@@ -30,15 +30,12 @@ extern int end;
 struct buffer_head * start_buffer = (struct buffer_head *) &end;
 struct buffer_head * hash_table[NR_HASH];
 static struct buffer_head * free_list;
-static struct task_struct * buffer_wait = NULL;
+static struct wait_queue * buffer_wait = NULL;
 int NR_BUFFERS = 0;
 
 static inline void wait_on_buffer(struct buffer_head * bh)
 {
-	cli();
-	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
-	sti();
+	mutex_wait(&bh->b_mutex);
 }
 
 int sys_sync(void)
@@ -49,6 +46,7 @@ int sys_sync(void)
 	sync_inodes();		/* write out inodes into buffers */
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		cond_resched();
 		wait_on_buffer(bh);
 		if (bh->b_dirt)
 			ll_rw_block(WRITE,bh);
@@ -63,6 +61,7 @@ int sync_dev(int dev)
 
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		cond_resched();
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
@@ -72,6 +71,7 @@ int sync_dev(int dev)
 	sync_inodes();
 	bh = start_buffer;
 	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
+		cond_resched();
 		if (bh->b_dev != dev)
 			continue;
 		wait_on_buffer(bh);
@@ -202,7 +202,7 @@ struct buffer_head * get_hash_table(int dev, int block)
  *
  * The algoritm is changed: hopefully better, and an elusive bug removed.
  */
-#define BADNESS(bh) (((bh)->b_dirt<<1)+(bh)->b_lock)
+#define BADNESS(bh) (((bh)->b_dirt<<1)+mutex_locked(&(bh)->b_mutex))
 struct buffer_head * getblk(int dev,int block)
 {
 	struct buffer_head * tmp, * bh;
@@ -222,7 +222,7 @@ repeat:
 /* and repeat until we find something good */
 	} while ((tmp = tmp->b_next_free) != free_list);
 	if (!bh) {
-		sleep_on(&buffer_wait);
+		sleep_on_queue_exclusive(&buffer_wait);
 		goto repeat;
 	}
 	wait_on_buffer(bh);
@@ -239,7 +239,7 @@ repeat:
 	if (find_buffer(dev,block))
 		goto repeat;
 /* OK, FINALLY we know that this buffer is the only one of it's kind, */
-/* and that it's unused (b_count=0), unlocked (b_lock=0), and clean */
+/* and that it's unused (b_count=0), unlocked, and clean */
 	bh->b_count=1;
 	bh->b_dirt=0;
 	bh->b_uptodate=0;
@@ -257,7 +257,7 @@ void brelse(struct buffer_head * buf)
 	wait_on_buffer(buf);
 	if (!(buf->b_count--))
 		panic("Trying to free free buffer");
-	wake_up(&buffer_wait);
+	wake_up_queue(&buffer_wait);
 }
 
 /*
@@ -287,11 +287,19 @@ __asm__("cld\n\t" \
 	::"c" (BLOCK_SIZE/4),"S" (from),"D" (to) \
 	:"cx","di","si")
 
+#define ZEROBLK(to) \
+__asm__("cld\n\t" \
+	"rep\n\t" \
+	"stosl\n\t" \
+	::"a" (0),"c" (BLOCK_SIZE/4),"D" (to) \
+	:"cx","di")
+
 /*
  * bread_page reads four buffers into memory at the desired address. It's
  * a function of its own, as there is some speed to be got by reading them
  * all at the same time, not waiting for one to be read, and then another
- * etc.
+ * etc. The page need not be cleared: holes and failed reads are
+ * zeroed here.
  */
 void bread_page(unsigned long address,int dev,int b[4])
 {
@@ -310,8 +318,44 @@ void bread_page(unsigned long address,int dev,int b[4])
 			wait_on_buffer(bh[i]);
 			if (bh[i]->b_uptodate)
 				COPYBLK((unsigned long) bh[i]->b_data,address);
+			else
+				ZEROBLK(address);
 			brelse(bh[i]);
-		}
+		} else
+			ZEROBLK(address);
+}
+
+/*
+ * Start reading blocks that will be wanted soon, without waiting for
+ * them. Zero block numbers, and blocks the cache already has (or is
+ * reading), are skipped. They reach the elevator together, in the
+ * order given, so one sweep of the disk gets them all.
+ */
+void bread_ahead(int dev, int * b, int n)
+{
+	struct buffer_head * bh;
+
+	for ( ; n-- > 0 ; b++) {
+		if (!*b || find_buffer(dev,*b))
+			continue;
+		if (!(bh = getblk(dev,*b)))
+			continue;
+		if (!bh->b_uptodate)
+			ll_rw_block(READA,bh);
+		bh->b_count--;
+	}
+}
+
+/*
+ * Is the block in the cache, read in and not busy? This doesn't sleep.
+ */
+int buffer_uptodate(int dev, int block)
+{
+	struct buffer_head * bh;
+
+	if (!(bh = find_buffer(dev,block)))
+		return 0;
+	return bh->b_uptodate && !mutex_locked(&bh->b_mutex);
 }
 
 /*
@@ -359,9 +403,8 @@ void buffer_init(long buffer_end)
 		h->b_dev = 0;
 		h->b_dirt = 0;
 		h->b_count = 0;
-		h->b_lock = 0;
+		mutex_init(&h->b_mutex);
 		h->b_uptodate = 0;
-		h->b_wait = NULL;
 		h->b_next = NULL;
 		h->b_prev = NULL;
 		h->b_data = (char *) b;
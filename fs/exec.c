@@ -21,11 +21,13 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <a.out.h>
+#include <sys/vtime.h>
 
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/segment.h>
 
 extern int sys_exit(int exit_code);
@@ -171,8 +173,11 @@ static unsigned long change_ldt(unsigned long text_size,unsigned long * page)
 	for (i=MAX_ARG_PAGES-1 ; i>=0 ; i--) {
 		data_base -= PAGE_SIZE;
 		if (page[i])
-			put_page(page[i],data_base);
+			put_dirty_page(page[i],data_base);
 	}
+	if (vtime_page)
+		put_shared_page(vtime_page,
+			get_base(current->ldt[2]) + VTIME_ADDR);
 	return data_limit;
 }
 
@@ -316,8 +321,10 @@ restart_interp:
 		}
 	}
 /* OK, This is the point of no return */
-	if (current->executable)
+	if (current->executable) {
+		del_exec_task(current);
 		iput(current->executable);
+	}
 	current->executable = inode;
 	for (i=0 ; i<32 ; i++)
 		current->sigaction[i].sa_handler = NULL;
@@ -325,8 +332,11 @@ restart_interp:
 		if ((current->close_on_exec>>i)&1)
 			sys_close(i);
 	current->close_on_exec = 0;
+	vfork_release();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
+/* listed only now: until here our tables held the old image */
+	add_exec_task(current);
 	if (last_task_used_math == current)
 		last_task_used_math = NULL;
 	current->used_math = 0;
@@ -22,6 +22,7 @@ int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
 	if ((left=count)<=0)
 		return 0;
 	while (left) {
+		cond_resched();
 		if (nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE)) {
 			if (!(bh=bread(inode->i_dev,nr)))
 				break;
@@ -19,25 +19,17 @@ static void write_inode(struct m_inode * inode);
 
 static inline void wait_on_inode(struct m_inode * inode)
 {
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	sti();
+	mutex_wait(&inode->i_mutex);
 }
 
 static inline void lock_inode(struct m_inode * inode)
 {
-	cli();
-	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
-	inode->i_lock=1;
-	sti();
+	mutex_lock(&inode->i_mutex);
 }
 
 static inline void unlock_inode(struct m_inode * inode)
 {
-	inode->i_lock=0;
-	wake_up(&inode->i_wait);
+	mutex_unlock(&inode->i_mutex);
 }
 
 void invalidate_inodes(int dev)
@@ -155,7 +147,7 @@ void iput(struct m_inode * inode)
 	if (!inode->i_count)
 		panic("iput: trying to free free inode");
 	if (inode->i_pipe) {
-		wake_up(&inode->i_wait);
+		wake_up_queue_all(&inode->i_wait);
 		if (--inode->i_count)
 			return;
 		free_page(inode->i_size);
@@ -204,7 +196,7 @@ struct m_inode * get_empty_inode(void)
 				last_inode = inode_table;
 			if (!last_inode->i_count) {
 				inode = last_inode;
-				if (!inode->i_dirt && !inode->i_lock)
+				if (!inode->i_dirt && !mutex_locked(&inode->i_mutex))
 					break;
 			}
 		}
@@ -231,7 +223,7 @@ struct m_inode * get_pipe_inode(void)
 
 	if (!(inode = get_empty_inode()))
 		return NULL;
-	if (!(inode->i_size=get_free_page())) {
+	if (!(inode->i_size=__get_free_page())) {
 		inode->i_count = 0;
 		return NULL;
 	}
@@ -30,27 +30,17 @@ int ROOT_DEV = 0;
 
 static void lock_super(struct super_block * sb)
 {
-	cli();
-	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
-	sb->s_lock = 1;
-	sti();
+	mutex_lock(&sb->s_mutex);
 }
 
 static void free_super(struct super_block * sb)
 {
-	cli();
-	sb->s_lock = 0;
-	wake_up(&(sb->s_wait));
-	sti();
+	mutex_unlock(&sb->s_mutex);
 }
 
 static void wait_on_super(struct super_block * sb)
 {
-	cli();
-	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
-	sti();
+	mutex_wait(&sb->s_mutex);
 }
 
 struct super_block * get_super(int dev)
@@ -255,8 +245,7 @@ void mount_root(void)
 	}
 	for(p = &super_block[0] ; p < &super_block[NR_SUPER] ; p++) {
 		p->s_dev = 0;
-		p->s_lock = 0;
-		p->s_wait = NULL;
+		mutex_init(&p->s_mutex);
 	}
 	if (!(p=read_super(ROOT_DEV)))
 		panic("Unable to mount root");
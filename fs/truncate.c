@@ -19,8 +19,10 @@ static void free_ind(int dev,int block)
 	if (bh=bread(dev,block)) {
 		p = (unsigned short *) bh->b_data;
 		for (i=0;i<512;i++,p++)
-			if (*p)
+			if (*p) {
 				free_block(dev,*p);
+				cond_resched();
+			}
 		brelse(bh);
 	}
 	free_block(dev,block);
@@ -37,8 +39,10 @@ static void free_dind(int dev,int block)
 	if (bh=bread(dev,block)) {
 		p = (unsigned short *) bh->b_data;
 		for (i=0;i<512;i++,p++)
-			if (*p)
+			if (*p) {
 				free_ind(dev,*p);
+				cond_resched();
+			}
 		brelse(bh);
 	}
 	free_block(dev,block);
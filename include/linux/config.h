@@ -45,4 +45,28 @@
  leave HD_TYPE undefined. This is the normal thing to do.
 */
 
+/*
+ * Define HW_TASK_SWITCH to switch tasks with a 'ljmp' to the task's
+ * TSS, as Linux used to, instead of swapping kernel stacks. With
+ * SWITCH_BENCH the cost of a task switch is measured with rdtsc (so
+ * it needs a pentium or better), and shown by show_stat(): build
+ * with and without HW_TASK_SWITCH to compare.
+ */
+/*#define HW_TASK_SWITCH */
+/*#define SWITCH_BENCH */
+
+/*
+ * Pages the compressed swap store (mm/swap.c) may grow to. It is used
+ * before any swap partition, and is the only swap on a diskless box.
+ * Undefine it to do without.
+ */
+#define ZSWAP_PAGES 256
+
+/*
+ * A page fault on the executable also reads ahead the pages after the
+ * faulting one, FAULT_AROUND in all, and maps those that are already
+ * in memory (see do_no_page()). 1 turns it off.
+ */
+#define FAULT_AROUND 8
+
 #endif
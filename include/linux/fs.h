@@ -7,6 +7,7 @@
 #define _FS_H
 
 #include <sys/types.h>
+#include <linux/mutex.h>
 
 /* devices are as follows: (same as minix, so we can use the minix
  * file system. These are major numbers.)
@@ -72,8 +73,7 @@ struct buffer_head {
 	unsigned char b_uptodate;
 	unsigned char b_dirt;		/* 0-clean,1-dirty */
 	unsigned char b_count;		/* users using this block */
-	unsigned char b_lock;		/* 0 - ok, 1 -locked */
-	struct task_struct * b_wait;
+	struct mutex b_mutex;		/* locked during I/O */
 	struct buffer_head * b_prev;
 	struct buffer_head * b_next;
 	struct buffer_head * b_prev_free;
@@ -99,13 +99,14 @@ struct m_inode {
 	unsigned char i_nlinks;
 	unsigned short i_zone[9];
 /* these are in memory also */
-	struct task_struct * i_wait;
+	struct wait_queue * i_wait;
+	struct task_struct * i_exec;	/* tasks running this */
 	unsigned long i_atime;
 	unsigned long i_ctime;
 	unsigned short i_dev;
 	unsigned short i_num;
 	unsigned short i_count;
-	unsigned char i_lock;
+	struct mutex i_mutex;
 	unsigned char i_dirt;
 	unsigned char i_pipe;
 	unsigned char i_mount;
@@ -137,8 +138,7 @@ struct super_block {
 	struct m_inode * s_isup;
 	struct m_inode * s_imount;
 	unsigned long s_time;
-	struct task_struct * s_wait;
-	unsigned char s_lock;
+	struct mutex s_mutex;
 	unsigned char s_rd_only;
 	unsigned char s_dirt;
 };
@@ -185,10 +185,13 @@ extern struct m_inode * get_pipe_inode(void);
 extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
+extern int ll_rw_page(int rw, int dev, int nr, char * buffer);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
+extern void bread_ahead(int dev, int * b, int n);
+extern int buffer_uptodate(int dev, int block);
 extern int new_block(int dev);
 extern void free_block(int dev, int block);
 extern struct m_inode * new_inode(int dev);
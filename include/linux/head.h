@@ -6,6 +6,7 @@ typedef struct desc_struct {
 } desc_table[256];
 
 extern unsigned long pg_dir[1024];
+extern unsigned long empty_zero_page[1024];
 extern desc_table idt,gdt;
 
 #define GDT_NUL 0
@@ -0,0 +1,28 @@
+#ifndef _INTERRUPT_H
+#define _INTERRUPT_H
+
+/*
+ * Bottom halves: the part of interrupt handling that doesn't need
+ * interrupts disabled. A handler marks its bottom half, and it is run
+ * with interrupts enabled on the way out of the interrupt (or of the
+ * next system call). Bottom halves never nest, and must not sleep.
+ */
+#define TIMER_BH	0
+#define TTY_BH		1
+#define HD_BH		2
+
+struct bh_struct {
+	void (*routine)(void);
+};
+
+extern unsigned long bh_active;
+extern unsigned long bh_mask;
+extern struct bh_struct bh_base[32];
+
+extern void init_bh(int nr, void (*routine)(void));
+extern void do_bottom_half(void);
+
+#define mark_bh(nr) \
+__asm__ __volatile__("btsl %1,%0":"=m" (bh_active):"ir" (nr))
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _KTIME_H
+#define _KTIME_H
+
+/*
+ * Cycle-level time keeping on top of the TSC, calibrated against the
+ * PIT by calibrate_tsc() at boot. Without a TSC everything falls back
+ * to jiffies.
+ */
+
+typedef unsigned long long cycles_t;
+typedef unsigned long long ktime_t;	/* nanoseconds since boot */
+
+#define get_cycles() ({ \
+cycles_t __c; \
+__asm__ __volatile__("rdtsc":"=A" (__c)); \
+__c;})
+
+/*
+ * n = n / base, returns n % base. A 64/32 divide done with two divl's,
+ * as we don't link against libgcc.
+ */
+#define do_div(n,base) ({ \
+unsigned long __upper, __low, __high, __mod; \
+__asm__("":"=a" (__low),"=d" (__high):"A" (n)); \
+__upper = __high; \
+if (__high) { \
+	__upper = __high % (base); \
+	__high = __high / (base); \
+} \
+__asm__("divl %2":"=a" (__low),"=d" (__mod) \
+	:"rm" (base),"0" (__low),"1" (__upper)); \
+__asm__("":"=A" (n):"a" (__low),"d" (__high)); \
+__mod;})
+
+/* cpu_features() bits */
+#define CPU_TSC		0x00000010
+#define CPU_SEP		0x00000800	/* sysenter/sysexit */
+
+struct timeval;
+
+extern unsigned long tsc_khz;		/* 0 if there is no TSC */
+extern unsigned long vtime_page;	/* see <sys/vtime.h> */
+
+extern unsigned long cpu_features(void);
+extern void calibrate_tsc(void);
+extern ktime_t cycles_to_ns(cycles_t cycles);
+extern ktime_t ktime_get(void);
+extern void do_gettimeofday(struct timeval * tv);
+extern void update_vtime(void);
+extern void vtime_init(void);
+
+#endif
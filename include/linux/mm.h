@@ -2,9 +2,45 @@
 #define _MM_H
 
 #define PAGE_SIZE 4096
+#define MAX_ORDER 8		/* blocks of up to 2^7 pages, 512kB */
+
+/* these are not to be changed without changing head.s etc */
+#define LOW_MEM 0x100000
+#define PAGING_MEMORY (15*1024*1024)
+#define PAGING_PAGES (PAGING_MEMORY>>12)
+#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
+#define USED 100
+
+#define PAGE_DIRTY	0x40
+#define PAGE_ACCESSED	0x20
+#define PAGE_RW		0x02
+#define PAGE_PRESENT	0x01
+
+#define invalidate() \
+__asm__("movl %%eax,%%cr3"::"a" (0))
+
+extern unsigned char mem_map [ PAGING_PAGES ];
 
 extern unsigned long get_free_page(void);
+extern unsigned long get_free_pages(int order);
+extern unsigned long __get_free_page(void);
+extern unsigned long __get_free_pages(int order);
+extern void refill_zero_pool(void);
 extern unsigned long put_page(unsigned long page,unsigned long address);
+extern unsigned long put_shared_page(unsigned long page,unsigned long address);
+extern unsigned long put_dirty_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
+extern void free_pages(unsigned long addr, int order);
+extern volatile void oom(void);
+
+/* swap.c */
+extern int swap_out(void);
+extern void swap_in(unsigned long * table_ptr);
+extern int swap_copy(unsigned long entry, unsigned long page);
+extern void swap_free(unsigned long entry);
+
+/* merge.c */
+extern int nr_merged;
+extern void merge_pages(void);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef _MUTEX_H
+#define _MUTEX_H
+
+/*
+ * Sleeping kernel locks. 'owner' is the task that took the lock; it is
+ * informational only, as buffer locks are released from the disk
+ * interrupt. The counters are never reset except when the structure
+ * holding the lock is reused: 'acquired' counts mutex_lock() calls,
+ * 'contended' the ones that had to sleep, and 'wait_time' the jiffies
+ * spent sleeping in them.
+ */
+struct mutex {
+	unsigned char locked;
+	struct task_struct * owner;
+	struct wait_queue * wait;
+	unsigned long acquired;
+	unsigned long contended;
+	unsigned long wait_time;
+};
+
+#define MUTEX_INIT {0,NULL,NULL,0,0,0}
+
+#define mutex_locked(m) ((m)->locked)
+
+extern void mutex_init(struct mutex * m);
+extern void mutex_lock(struct mutex * m);
+extern void mutex_unlock(struct mutex * m);
+extern void mutex_wait(struct mutex * m);
+extern void show_lock_stat(void);
+
+#endif
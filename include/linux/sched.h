@@ -7,10 +7,13 @@
 #define FIRST_TASK task[0]
 #define LAST_TASK task[NR_TASKS-1]
 
+#include <linux/config.h>
 #include <linux/head.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
+#include <linux/timer.h>
 #include <signal.h>
+#include <sched.h>
 
 #if (NR_OPEN > 32)
 #error "Currently the close-on-exec-flags are in one word, max 32 files/proc"
@@ -22,6 +25,14 @@
 #define TASK_ZOMBIE		3
 #define TASK_STOPPED		4
 
+/*
+ * Scheduler modes. The mode is chosen at boot time from the word at
+ * offset 506 in the boot-sector (see tools/build.c), 0 being the old
+ * counter/priority scheduler.
+ */
+#define SCHED_MODE_COUNTER	0
+#define SCHED_MODE_FAIR		1
+
 #ifndef NULL
 #define NULL ((void *) 0)
 #endif
@@ -37,6 +48,28 @@ extern int tty_write(unsigned minor,char * buf,int count);
 
 typedef int (*fn_ptr)();
 
+/*
+ * One entry per sleeper, see sleep_on_queue(). 'exclusive' waiters
+ * are woken one at a time.
+ */
+struct wait_queue {
+	struct task_struct * task;
+	struct wait_queue * next;
+	int exclusive;
+};
+
+/*
+ * The fair scheduler accounts cpu-time to sessions as well as to
+ * tasks, so that one session can't starve the others by running
+ * lots of processes. count==0 means the slot is free.
+ */
+struct sched_group {
+	long session;
+	long count;
+	unsigned long vruntime;
+	unsigned long min_vruntime;
+};
+
 struct i387_struct {
 	long	cwd;
 	long	swd;
@@ -91,6 +124,16 @@ struct task_struct {
 	unsigned short gid,egid,sgid;
 	long alarm;
 	long utime,stime,cutime,cstime,start_time;
+	unsigned long vruntime;
+	struct sched_group * group;
+	long policy,rt_priority;
+	struct timer_list real_timer;	/* fires SIGALRM at 'alarm' */
+	struct hrtimer it_real;		/* ITIMER_REAL, and its interval: */
+	long it_real_sec,it_real_nsec;
+	unsigned long nvcsw,nivcsw;
+	long run_delay,sleep_time,isleep_time,sched_stamp;
+	struct task_struct * vfork_parent;	/* whose memory we borrow */
+	struct task_struct * next_exec, * prev_exec;	/* same executable */
 	unsigned short used_math;
 /* file system info */
 	int tty;		/* -1 if no tty, so it must be signed */
@@ -117,6 +160,13 @@ struct task_struct {
 /* pid etc.. */	0,-1,0,0,0, \
 /* uid etc */	0,0,0,0,0,0, \
 /* alarm */	0,0,0,0,0,0, \
+/* fair */	0,NULL, \
+/* policy */	SCHED_OTHER,0, \
+/* timer */	{NULL,NULL,0,0,NULL}, \
+/* itimer */	HRTIMER_INIT,0,0, \
+/* stats */	0,0,0,0,0,0, \
+/* vfork */	NULL, \
+/* exec list */	NULL,NULL, \
 /* math */	0, \
 /* fs info */	-1,0022,NULL,NULL,NULL,0, \
 /* filp */	{NULL,}, \
@@ -138,13 +188,33 @@ extern struct task_struct *last_task_used_math;
 extern struct task_struct *current;
 extern long volatile jiffies;
 extern long startup_time;
+extern int sched_mode;
 
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
-extern void add_timer(long jiffies, void (*fn)(void));
 extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
 extern void wake_up(struct task_struct ** p);
+extern void signal_wake_up(struct task_struct * p);
+extern void vfork_release(void);
+extern void add_exec_task(struct task_struct * p);
+extern void del_exec_task(struct task_struct * p);
+extern void sleep_on_queue(struct wait_queue ** q);
+extern void sleep_on_queue_exclusive(struct wait_queue ** q);
+extern void wake_up_queue(struct wait_queue ** q);
+extern void wake_up_queue_all(struct wait_queue ** q);
+extern void set_alarm(long when);
+extern int need_resched;
+extern void sched_fork(struct task_struct * p);
+extern void sched_exit(struct task_struct * p);
+extern void sched_setsid(struct task_struct * p);
+
+/*
+ * The kernel isn't preemptive: a task that runs out of time-slice
+ * while in the kernel just gets need_resched set. Long loops call
+ * cond_resched() at points where it is safe to sleep.
+ */
+#define cond_resched() do { if (need_resched) schedule(); } while (0)
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
@@ -162,6 +232,7 @@ __asm__("str %%ax\n\t" \
 	"shrl $4,%%eax" \
 	:"=a" (n) \
 	:"a" (0),"i" (FIRST_TSS_ENTRY<<3))
+#ifdef HW_TASK_SWITCH
 /*
  *	switch_to(n) should switch tasks to task nr n, first
  * checking that n isn't the current task, in which case it does nothing.
@@ -182,6 +253,58 @@ __asm__("cmpl %%ecx,_current\n\t" \
 	::"m" (*&__tmp.a),"m" (*&__tmp.b), \
 	"d" (_TSS(n)),"c" ((long) task[n])); \
 }
+#else
+/*
+ *	switch_to(n) switches to task nr n without a hardware task
+ * switch. Only task 0's TSS is ever loaded, and all it does is give
+ * the kernel stack for entries from user mode, so its esp0 is pointed
+ * at the new task. The user registers are already on the kernel
+ * stack; we push the ones gcc expects preserved, plus %fs and %gs,
+ * which have to be reloaded after the lldt, and swap stacks. The
+ * saved esp/eip go in the task's own tss. TS is set by hand unless
+ * the new task owns the math co-processor, so that
+ * math_state_restore() stays lazy. This must only be used from
+ * schedule(): every switched-out task resumes at the same '1:'.
+ */
+#define switch_to(n) {\
+struct task_struct * __prev = current, * __next = task[n]; \
+unsigned long __flags; \
+long __d0, __d1; \
+if (__next != __prev) { \
+	save_flags(__flags); \
+	cli(); \
+	init_task.task.tss.esp0 = PAGE_SIZE + (long) __next; \
+	current = __next; \
+	__asm__("lldt %%ax"::"a" (__next->tss.ldt)); \
+	if (__next == last_task_used_math) \
+		__asm__("clts"); \
+	else \
+		__asm__("movl %%cr0,%%eax ; orl $8,%%eax ; movl %%eax,%%cr0" \
+			:::"ax"); \
+	__asm__ __volatile__("pushl %%ebp\n\t" \
+		"pushl %%esi\n\t" \
+		"pushl %%edi\n\t" \
+		"pushl %%ebx\n\t" \
+		"push %%fs\n\t" \
+		"push %%gs\n\t" \
+		"movl %%esp,%0\n\t" \
+		"movl $1f,%1\n\t" \
+		"movl %%ecx,%%esp\n\t" \
+		"jmp *%%edx\n" \
+		"1:\tpop %%gs\n\t" \
+		"pop %%fs\n\t" \
+		"popl %%ebx\n\t" \
+		"popl %%edi\n\t" \
+		"popl %%esi\n\t" \
+		"popl %%ebp" \
+		:"=m" (__prev->tss.esp),"=m" (__prev->tss.eip), \
+		 "=c" (__d0),"=d" (__d1) \
+		:"2" (__next->tss.esp),"3" (__next->tss.eip) \
+		:"ax","memory"); \
+	restore_flags(__flags); \
+} \
+}
+#endif
 
 #define PAGE_ALIGN(n) (((n)+0xfff)&0xfffff000)
 
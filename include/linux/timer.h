@@ -0,0 +1,49 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+/*
+ * Kernel timers. The timer_list is owned by the caller (static, part of
+ * some other structure or malloc'ed), so there is no limit to how many
+ * there can be. 'function' gets called with 'data' as its argument from
+ * the timer bottom half, with interrupts enabled, once 'jiffies' has
+ * reached 'expires'. A timer is pending while 'pprev' is non-NULL.
+ */
+struct timer_list {
+	struct timer_list * next;
+	struct timer_list ** pprev;
+	unsigned long expires;
+	unsigned long data;
+	void (*function)();
+};
+
+#define timer_pending(t) ((t)->pprev != NULL)
+
+/*
+ * High-resolution timers expire at 'sub' PIT counts (of LATCH to the
+ * tick) into jiffy 'expires'. They are kept sorted, and the PIT is
+ * made to interrupt when the first one is due, so they are accurate
+ * to well below a tick. 'function' is called from the timer interrupt,
+ * with interrupts disabled.
+ */
+struct hrtimer {
+	struct hrtimer * next;
+	unsigned long expires;
+	unsigned long sub;
+	unsigned long data;
+	void (*function)();
+	int pending;
+};
+
+#define HRTIMER_INIT {NULL,0,0,0,NULL,0}
+
+extern void init_timer(struct timer_list * timer);
+extern void add_timer(struct timer_list * timer);
+extern int del_timer(struct timer_list * timer);
+extern void run_timer_list(void);
+extern long timer_ticks_left(long max);
+
+extern void hrtimer_start(struct hrtimer * timer, long sec, long nsec);
+extern int hrtimer_cancel(struct hrtimer * timer);
+extern void hrtimer_left(struct hrtimer * timer, long * sec, long * nsec);
+
+#endif
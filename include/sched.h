@@ -0,0 +1,19 @@
+#ifndef _POSIX_SCHED_H
+#define _POSIX_SCHED_H
+
+#include <sys/types.h>
+
+/*
+ * Scheduling policies. SCHED_FIFO and SCHED_RR tasks have a static
+ * priority 1..SCHED_MAX_PRIO and always run before SCHED_OTHER ones.
+ */
+#define SCHED_OTHER	0
+#define SCHED_FIFO	1
+#define SCHED_RR	2
+
+#define SCHED_MAX_PRIO	99
+
+extern int sched_setscheduler(pid_t pid, int policy, int prio);
+extern int sched_getscheduler(pid_t pid);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _SYS_TIME_H
+#define _SYS_TIME_H
+
+#include <sys/types.h>
+
+struct timeval {
+	time_t tv_sec;		/* seconds */
+	long tv_usec;		/* microseconds */
+};
+
+struct timezone {
+	int tz_minuteswest;	/* minutes west of Greenwich */
+	int tz_dsttime;		/* type of dst correction */
+};
+
+#define ITIMER_REAL	0
+#define ITIMER_VIRTUAL	1
+#define ITIMER_PROF	2
+
+struct itimerval {
+	struct timeval it_interval;	/* timer interval */
+	struct timeval it_value;	/* current value */
+};
+
+int gettimeofday(struct timeval * tv, struct timezone * tz);
+int setitimer(int which, const struct itimerval * value,
+	struct itimerval * ovalue);
+
+#endif
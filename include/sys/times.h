@@ -10,6 +10,20 @@ struct tms {
 	time_t tms_cstime;
 };
 
+/*
+ * Scheduler statistics of one task, in jiffies: time spent runnable
+ * but waiting for the cpu, and time blocked uninterruptibly (mostly
+ * I/O) and interruptibly.
+ */
+struct schedstat {
+	unsigned long nvcsw;		/* voluntary context switches */
+	unsigned long nivcsw;		/* involuntary context switches */
+	time_t run_delay;
+	time_t sleep_time;
+	time_t isleep_time;
+};
+
 extern time_t times(struct tms * tp);
+extern time_t schedstat(int pid, struct schedstat * sp);
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef _SYS_VTIME_H
+#define _SYS_VTIME_H
+
+#include <sys/time.h>
+
+/*
+ * The kernel maps a read-only time page at VTIME_ADDR in the data
+ * segment of every program, and rewrites it on each clock tick. The
+ * time can then be read without a system call. 'seq' is odd while the
+ * kernel is updating the page; readers retry if it was odd or has
+ * changed during the read.
+ */
+#define VTIME_ADDR	0x3c00000	/* 60MB, above any sane brk */
+#define VTIME_FEATURES	0x3c00004	/* &((struct vtime *) VTIME_ADDR)->features */
+
+#define VTIME_SYSENTER	1		/* the kernel takes system calls by sysenter */
+
+struct vtime {
+	unsigned long seq;
+	unsigned long features;
+	long jiffies;
+	long hz;
+	long tv_sec;			/* wall time at the last tick */
+	long tv_usec;
+	unsigned long long tsc_stamp;	/* TSC at the last tick */
+	unsigned long tsc_khz;		/* 0 if there is no TSC */
+	unsigned long cyc2ns_mult;	/* ns per cycle << cyc2ns_shift */
+	unsigned long cyc2ns_shift;
+};
+
+static inline void vtime_gettimeofday(struct timeval * tv)
+{
+	volatile struct vtime * vt = (volatile struct vtime *) VTIME_ADDR;
+	unsigned long seq, lo, hi, usec;
+	unsigned long long cycles, ns;
+
+	do {
+		while ((seq = vt->seq) & 1)
+			/* nothing */;
+		tv->tv_sec = vt->tv_sec;
+		usec = vt->tv_usec;
+		ns = 0;
+		if (vt->tsc_khz) {
+			__asm__ __volatile__("rdtsc":"=A" (cycles));
+			cycles -= vt->tsc_stamp;
+			lo = cycles;
+			hi = cycles >> 32;
+			ns = (((unsigned long long) lo * vt->cyc2ns_mult)
+				>> vt->cyc2ns_shift) +
+			     (((unsigned long long) hi * vt->cyc2ns_mult)
+				<< (32 - vt->cyc2ns_shift));
+		}
+	} while (seq != vt->seq);
+	usec += ns / 1000;
+	tv->tv_sec += usec / 1000000;
+	tv->tv_usec = usec % 1000000;
+}
+
+#endif
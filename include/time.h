@@ -27,6 +27,11 @@ struct tm {
 	int tm_isdst;
 };
 
+struct timespec {
+	time_t tv_sec;		/* seconds */
+	long tv_nsec;		/* nanoseconds */
+};
+
 clock_t clock(void);
 time_t time(time_t * tp);
 double difftime(time_t time2, time_t time1);
@@ -38,5 +43,6 @@ struct tm * gmtime(const time_t *tp);
 struct tm *localtime(const time_t * tp);
 size_t strftime(char * s, size_t smax, const char * fmt, const struct tm * tp);
 void tzset(void);
+int nanosleep(const struct timespec * rqtp, struct timespec * rmtp);
 
 #endif
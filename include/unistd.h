@@ -129,12 +129,42 @@
 #define __NR_ssetmask	69
 #define __NR_setreuid	70
 #define __NR_setregid	71
+#define __NR_sched_setscheduler	72
+#define __NR_sched_getscheduler	73
+#define __NR_schedstat	74
+#define __NR_nanosleep	75
+#define __NR_setitimer	76
+#define __NR_gettimeofday	77
+#define __NR_vfork	78
+#define __NR_swapon	79
+
+/*
+ * Programs built with -D__SYSENTER__ enter the kernel by sysenter when
+ * the time page says it is set up (VTIME_FEATURES & VTIME_SYSENTER in
+ * <sys/vtime.h>), and by int 0x80 otherwise. The kernel's own tasks 0
+ * and 1 have no time page, so the kernel is built without it.
+ */
+#ifdef __SYSENTER__
+#define __SYSCALL_TRAP \
+	"testb $1,0x3c00004\n\t" \
+	"je 1f\n\t" \
+	"pushl %%ebp\n\t" \
+	"pushl $2f\n\t" \
+	"movl %%esp,%%ebp\n\t" \
+	"sysenter\n" \
+	"2:\tpopl %%ebp\n\t" \
+	"jmp 3f\n" \
+	"1:\tint $0x80\n" \
+	"3:"
+#else
+#define __SYSCALL_TRAP "int $0x80"
+#endif
 
 #define _syscall0(type,name) \
 type name(void) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_TRAP \
 	: "=a" (__res) \
 	: "0" (__NR_##name)); \
 if (__res >= 0) \
@@ -147,7 +177,7 @@ return -1; \
 type name(atype a) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_TRAP \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a))); \
 if (__res >= 0) \
@@ -160,7 +190,7 @@ return -1; \
 type name(atype a,btype b) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_TRAP \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b))); \
 if (__res >= 0) \
@@ -173,7 +203,7 @@ return -1; \
 type name(atype a,btype b,ctype c) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL_TRAP \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c))); \
 if (__res>=0) \
@@ -208,6 +238,7 @@ volatile void exit(int status);
 volatile void _exit(int status);
 int fcntl(int fildes, int cmd, ...);
 int fork(void);
+int vfork(void);
 int getpid(void);
 int getuid(void);
 int geteuid(void);
@@ -232,6 +263,7 @@ void (*signal(int sig, void (*fn)(int)))(int);
 int stat(const char * filename, struct stat * stat_buf);
 int fstat(int fildes, struct stat * stat_buf);
 int stime(time_t * tptr);
+int swapon(const char * specialfile);
 int sync(void);
 time_t time(time_t * tloc);
 time_t times(struct tms * tbuf);
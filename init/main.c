@@ -28,6 +28,7 @@ static inline _syscall0(int,sync)
 #include <linux/tty.h>
 #include <linux/sched.h>
 #include <linux/head.h>
+#include <linux/ktime.h>
 #include <asm/system.h>
 #include <asm/io.h>
 
@@ -57,6 +58,7 @@ extern long startup_time;
  */
 #define EXT_MEM_K (*(unsigned short *)0x90002)
 #define DRIVE_INFO (*(struct drive_info *)0x90080)
+#define ORIG_SCHED_MODE (*(unsigned short *)0x901FA)
 #define ORIG_ROOT_DEV (*(unsigned short *)0x901FC)
 
 /*
@@ -93,6 +95,8 @@ static void time_init(void)
 	BCD_TO_BIN(time.tm_year);
 	time.tm_mon--;
 	startup_time = kernel_mktime(&time);
+	calibrate_tsc();
+	vtime_init();
 }
 
 static long memory_end = 0;
@@ -109,6 +113,7 @@ void main(void)		/* This really IS void, no error here. */
  */
  	ROOT_DEV = ORIG_ROOT_DEV;
  	drive_info = DRIVE_INFO;
+	sched_mode = ORIG_SCHED_MODE;
 	memory_end = (1<<20) + (EXT_MEM_K<<10);
 	memory_end &= 0xfffff000;
 	if (memory_end > 16*1024*1024)
@@ -143,7 +148,8 @@ void main(void)		/* This really IS void, no error here. */
  * signal to awaken, but task0 is the sole exception (see 'schedule()')
  * as task 0 gets activated at every idle moment (when no other tasks
  * can run). For task0 'pause()' just means we go check if some other
- * task can run, and if not we return here.
+ * task can run, and if not we halt the cpu until the next interrupt
+ * (which need not be the next tick, see 'cpu_idle()') and return here.
  */
 	for(;;) pause();
 }
@@ -49,7 +49,7 @@ struct blk_dev_struct {
 
 extern struct blk_dev_struct blk_dev[NR_BLK_DEV];
 extern struct request request[NR_REQUEST];
-extern struct task_struct * wait_for_request;
+extern struct wait_queue * wait_for_request;
 
 #ifdef MAJOR_NR
 
@@ -100,10 +100,9 @@ static void (DEVICE_REQUEST)(void);
 
 extern inline void unlock_buffer(struct buffer_head * bh)
 {
-	if (!bh->b_lock)
+	if (!mutex_locked(&bh->b_mutex))
 		printk(DEVICE_NAME ": free buffer being unlocked\n");
-	bh->b_lock=0;
-	wake_up(&bh->b_wait);
+	mutex_unlock(&bh->b_mutex);
 }
 
 extern inline void end_request(int uptodate)
@@ -115,11 +114,15 @@ extern inline void end_request(int uptodate)
 	}
 	if (!uptodate) {
 		printk(DEVICE_NAME " I/O error\n\r");
-		printk("dev %04x, block %d\n\r",CURRENT->dev,
-			CURRENT->bh->b_blocknr);
+		printk("dev %04x, sector %d\n\r",CURRENT->dev,
+			CURRENT->sector);
 	}
 	wake_up(&CURRENT->waiting);
-	wake_up(&wait_for_request);
+/* only readers may take the last third: one woken writer could strand them */
+	if (CURRENT >= request + (NR_REQUEST*2)/3)
+		wake_up_queue_all(&wait_for_request);
+	else
+		wake_up_queue(&wait_for_request);
 	CURRENT->dev = -1;
 	CURRENT = CURRENT->next;
 }
@@ -131,7 +134,7 @@ repeat: \
 	if (MAJOR(CURRENT->dev) != MAJOR_NR) \
 		panic(DEVICE_NAME ": request list destroyed"); \
 	if (CURRENT->bh) { \
-		if (!CURRENT->bh->b_lock) \
+		if (!mutex_locked(&CURRENT->bh->b_mutex)) \
 			panic(DEVICE_NAME ": block not locked"); \
 	}
 
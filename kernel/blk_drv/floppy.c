@@ -119,6 +119,7 @@ static unsigned char track = 0;
 static unsigned char seek_track = 0;
 static unsigned char current_track = 255;
 static unsigned char command = 0;
+static struct timer_list floppy_timer = { NULL, NULL, 0, 0, NULL };
 unsigned char selected = 0;
 struct task_struct * wait_on_floppy_select = NULL;
 
@@ -401,6 +402,17 @@ static void reset_floppy(void)
 	sti();
 }
 
+/*
+ * Timer functions run with interrupts enabled, but the floppy code
+ * expects to be called like an interrupt handler.
+ */
+static void floppy_timer_fn(unsigned long data)
+{
+	cli();
+	((void (*)(void)) data)();
+	sti();
+}
+
 static void floppy_on_interrupt(void)
 {
 /* We cannot do a floppy-select, as that might sleep. We just force it */
@@ -409,7 +421,10 @@ static void floppy_on_interrupt(void)
 		current_DOR &= 0xFC;
 		current_DOR |= current_drive;
 		outb(current_DOR,FD_DOR);
-		add_timer(2,&transfer);
+		floppy_timer.expires = jiffies + 2;
+		floppy_timer.function = floppy_timer_fn;
+		floppy_timer.data = (unsigned long) transfer;
+		add_timer(&floppy_timer);
 	} else
 		transfer();
 }
@@ -417,6 +432,7 @@ static void floppy_on_interrupt(void)
 void do_fd_request(void)
 {
 	unsigned int block;
+	int ticks;
 
 	seek = 0;
 	if (reset) {
@@ -451,7 +467,16 @@ void do_fd_request(void)
 		command = FD_WRITE;
 	else
 		panic("do_fd_request: unknown command");
-	add_timer(ticks_to_floppy_on(current_drive),&floppy_on_interrupt);
+	if (!(ticks = ticks_to_floppy_on(current_drive))) {
+		cli();
+		floppy_on_interrupt();
+		sti();
+		return;
+	}
+	floppy_timer.expires = jiffies + ticks;
+	floppy_timer.function = floppy_timer_fn;
+	floppy_timer.data = (unsigned long) floppy_on_interrupt;
+	add_timer(&floppy_timer);
 }
 
 void floppy_init(void)
@@ -18,6 +18,7 @@
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/hdreg.h>
+#include <linux/interrupt.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
@@ -262,8 +263,7 @@ static void read_intr(void)
 		do_hd = &read_intr;
 		return;
 	}
-	end_request(1);
-	do_hd_request();
+	mark_bh(HD_BH);
 }
 
 static void write_intr(void)
@@ -280,6 +280,16 @@ static void write_intr(void)
 		port_write(HD_DATA,CURRENT->buffer,256);
 		return;
 	}
+	mark_bh(HD_BH);
+}
+
+/*
+ * A request that completed without errors is finished here, with
+ * interrupts enabled. Nothing starts a new command before that, as
+ * CURRENT is still set.
+ */
+static void hd_bh(void)
+{
 	end_request(1);
 	do_hd_request();
 }
@@ -343,6 +353,7 @@ void do_hd_request(void)
 void hd_init(void)
 {
 	blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+	init_bh(HD_BH,hd_bh);
 	set_intr_gate(0x2E,&hd_interrupt);
 	outb_p(inb_p(0x21)&0xfb,0x21);
 	outb(inb_p(0xA1)&0xbf,0xA1);
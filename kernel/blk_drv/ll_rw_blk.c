@@ -23,7 +23,7 @@ struct request request[NR_REQUEST];
 /*
  * used to wait on when there are no free requests
  */
-struct task_struct * wait_for_request = NULL;
+struct wait_queue * wait_for_request = NULL;
 
 /* blk_dev_struct is:
  *	do_request-address
@@ -41,19 +41,14 @@ struct blk_dev_struct blk_dev[NR_BLK_DEV] = {
 
 static inline void lock_buffer(struct buffer_head * bh)
 {
-	cli();
-	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
-	bh->b_lock=1;
-	sti();
+	mutex_lock(&bh->b_mutex);
 }
 
 static inline void unlock_buffer(struct buffer_head * bh)
 {
-	if (!bh->b_lock)
+	if (!mutex_locked(&bh->b_mutex))
 		printk("ll_rw_block.c: buffer not locked\n\r");
-	bh->b_lock = 0;
-	wake_up(&bh->b_wait);
+	mutex_unlock(&bh->b_mutex);
 }
 
 /*
@@ -93,7 +88,7 @@ static void make_request(int major,int rw, struct buffer_head * bh)
 /* WRITEA/READA is special case - it is not really needed, so if the */
 /* buffer is locked, we just forget about it, else it's a normal read */
 	if (rw_ahead = (rw == READA || rw == WRITEA)) {
-		if (bh->b_lock)
+		if (mutex_locked(&bh->b_mutex))
 			return;
 		if (rw == READA)
 			rw = READ;
@@ -126,7 +121,7 @@ repeat:
 			unlock_buffer(bh);
 			return;
 		}
-		sleep_on(&wait_for_request);
+		sleep_on_queue_exclusive(&wait_for_request);
 		goto repeat;
 	}
 /* fill up the request-info, and add it to the queue */
@@ -154,6 +149,64 @@ void ll_rw_block(int rw, struct buffer_head * bh)
 	make_request(major,rw,bh);
 }
 
+/*
+ * Page i/o for swapping: a 4kB page, 'nr' counted in pages, read or
+ * written straight from 'buffer'. The caller sleeps until it is done.
+ * The request is for 8 sectors, so the driver has to go on through
+ * nr_sectors: hd and the ramdisk do, the floppy driver doesn't.
+ *
+ * The buffer head lives on our stack and is in no list: it is only
+ * there for end_request() to unlock, and to say how it went. Returns
+ * 0, or -EIO.
+ */
+int ll_rw_page(int rw, int dev, int nr, char * buffer)
+{
+	struct request * req;
+	struct buffer_head bh;
+	unsigned int major = MAJOR(dev);
+
+	if (major >= NR_BLK_DEV || !(blk_dev[major].request_fn)) {
+		printk("Trying to read nonexistent block-device\n\r");
+		return -ENXIO;
+	}
+	if (rw!=READ && rw!=WRITE)
+		panic("Bad block dev command, must be R/W");
+repeat:
+/* as in make_request(): the last third of the requests is for reads */
+	if (rw == READ)
+		req = request+NR_REQUEST;
+	else
+		req = request+((NR_REQUEST*2)/3);
+	while (--req >= request)
+		if (req->dev<0)
+			break;
+	if (req < request) {
+		sleep_on_queue_exclusive(&wait_for_request);
+		goto repeat;
+	}
+	bh.b_data = buffer;
+	bh.b_blocknr = nr<<2;
+	bh.b_dev = dev;
+	bh.b_uptodate = 0;
+	bh.b_dirt = 0;
+	bh.b_count = 1;
+	mutex_init(&bh.b_mutex);
+	lock_buffer(&bh);
+/* fill up the request-info, and add it to the queue */
+	req->dev = dev;
+	req->cmd = rw;
+	req->errors = 0;
+	req->sector = nr<<3;
+	req->nr_sectors = 8;
+	req->buffer = buffer;
+	req->waiting = NULL;
+	req->bh = &bh;
+	req->next = NULL;
+	add_request(major+blk_dev,req);
+	mutex_wait(&bh.b_mutex);
+	return bh.b_uptodate ? 0 : -EIO;
+}
+
 void blk_dev_init(void)
 {
 	int i;
@@ -26,6 +26,8 @@ buf = 16
 
 startup	= 256		/* chars left in write queue when we restart it */
 
+counter	= 4		/* offset of counter in the task-struct */
+
 /*
  * These are the actual interrupt routines. They look where
  * the interrupt is coming from, and take appropriate action.
@@ -67,7 +69,17 @@ rep_int:
 	jmp rep_int
 end:	movb $0x20,%al
 	outb %al,$0x20		/* EOI */
-	pop %ds
+	movl _bh_mask,%eax
+	andl _bh_active,%eax
+	je 1f
+	call _do_bottom_half
+1:	testl $3,32(%esp)	/* from user mode? then a real-time task */
+	je 1f			/* woken by us (counter==0) can run now */
+	movl _current,%eax
+	cmpl $0,counter(%eax)
+	jne 1f
+	call _schedule
+1:	pop %ds
 	pop %es
 	popl %eax
 	popl %ebx
@@ -22,6 +22,7 @@
 
 #include <linux/sched.h>
 #include <linux/tty.h>
+#include <linux/interrupt.h>
 #include <asm/segment.h>
 #include <asm/system.h>
 
@@ -102,8 +103,11 @@ struct tty_queue * table_list[]={
 	&tty_table[2].read_q, &tty_table[2].write_q
 	};
 
+static void tty_bh(void);
+
 void tty_init(void)
 {
+	init_bh(TTY_BH,tty_bh);
 	rs_init();
 	con_init();
 }
@@ -115,8 +119,10 @@ void tty_intr(struct tty_struct * tty, int mask)
 	if (tty->pgrp <= 0)
 		return;
 	for (i=0;i<NR_TASKS;i++)
-		if (task[i] && task[i]->pgrp==tty->pgrp)
+		if (task[i] && task[i]->pgrp==tty->pgrp) {
 			task[i]->signal |= mask;
+			signal_wake_up(task[i]);
+		}
 }
 
 static void sleep_if_empty(struct tty_queue * queue)
@@ -242,7 +248,7 @@ int tty_read(unsigned channel, char * buf, int nr)
 	if (time && !minimum) {
 		minimum=1;
 		if (flag=(!oldalarm || time+jiffies<oldalarm))
-			current->alarm = time+jiffies;
+			set_alarm(time+jiffies);
 	}
 	if (minimum>nr)
 		minimum=nr;
@@ -272,16 +278,16 @@ int tty_read(unsigned channel, char * buf, int nr)
 		} while (nr>0 && !EMPTY(tty->secondary));
 		if (time && !L_CANON(tty))
 			if (flag=(!oldalarm || time+jiffies<oldalarm))
-				current->alarm = time+jiffies;
+				set_alarm(time+jiffies);
 			else
-				current->alarm = oldalarm;
+				set_alarm(oldalarm);
 		if (L_CANON(tty)) {
 			if (b-buf)
 				break;
 		} else if (b-buf >= minimum)
 			break;
 	}
-	current->alarm = oldalarm;
+	set_alarm(oldalarm);
 	if (current->signal && !(b-buf))
 		return -EINTR;
 	return (b-buf);
@@ -338,10 +344,22 @@ int tty_write(unsigned channel, char * buf, int nr)
  * I don't think we sleep here under normal circumstances
  * anyway, which is good, as the task sleeping might be
  * totally innocent.
+ *
+ * The cooking itself is done by the tty bottom half, for every tty
+ * that has raw characters waiting.
  */
 void do_tty_interrupt(int tty)
 {
-	copy_to_cooked(tty_table+tty);
+	mark_bh(TTY_BH);
+}
+
+static void tty_bh(void)
+{
+	int i;
+
+	for (i = 0 ; i < 3 ; i++)
+		if (!EMPTY(tty_table[i].read_q))
+			copy_to_cooked(tty_table+i);
 }
 
 void chr_dev_init(void)
@@ -25,6 +25,7 @@ void release(struct task_struct * p)
 	for (i=1 ; i<NR_TASKS ; i++)
 		if (task[i]==p) {
 			task[i]=NULL;
+			sched_exit(p);
 			free_page((long)p);
 			schedule();
 			return;
@@ -36,9 +37,10 @@ static inline int send_sig(long sig,struct task_struct * p,int priv)
 {
 	if (!p || sig<1 || sig>32)
 		return -EINVAL;
-	if (priv || (current->euid==p->euid) || suser())
+	if (priv || (current->euid==p->euid) || suser()) {
 		p->signal |= (1<<(sig-1));
-	else
+		signal_wake_up(p);
+	} else
 		return -EPERM;
 	return 0;
 }
@@ -48,8 +50,10 @@ static void kill_session(void)
 	struct task_struct **p = NR_TASKS + task;
 	
 	while (--p > &FIRST_TASK) {
-		if (*p && (*p)->session == current->session)
+		if (*p && (*p)->session == current->session) {
 			(*p)->signal |= 1<<(SIGHUP-1);
+			signal_wake_up(*p);
+		}
 	}
 }
 
@@ -91,6 +95,7 @@ static void tell_father(int pid)
 			if (task[i]->pid != pid)
 				continue;
 			task[i]->signal |= (1<<(SIGCHLD-1));
+			signal_wake_up(task[i]);
 			return;
 		}
 /* if we don't find any fathers, we just release ourselves */
@@ -103,6 +108,9 @@ int do_exit(long code)
 {
 	int i;
 
+	set_alarm(0);
+	hrtimer_cancel(&current->it_real);
+	vfork_release();
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	for (i=0 ; i<NR_TASKS ; i++)
@@ -119,6 +127,7 @@ int do_exit(long code)
 	current->pwd=NULL;
 	iput(current->root);
 	current->root=NULL;
+	del_exec_task(current);
 	iput(current->executable);
 	current->executable=NULL;
 	if (current->leader && current->tty >= 0)
@@ -18,6 +18,7 @@
 #include <asm/system.h>
 
 extern void write_verify(unsigned long address);
+extern void ret_from_fork(void);
 
 long last_pid=0;
 
@@ -60,12 +61,38 @@ int copy_mem(int nr,struct task_struct * p)
 	return 0;
 }
 
+/*
+ * A vfork() child runs in its parent's memory, with the parent asleep,
+ * until it execs or exits. Then it goes back to its own (empty) 64MB
+ * slot and wakes the parent. Called from both places, before they
+ * free the page tables - which are then the child's own, if any.
+ */
+void vfork_release(void)
+{
+	unsigned long base;
+	int nr;
+
+	if (!current->vfork_parent)
+		return;
+	for (nr=0 ; nr<NR_TASKS ; nr++)
+		if (task[nr] == current)
+			break;
+	base = nr * 0x4000000;
+	current->start_code = base;
+	set_base(current->ldt[1],base);
+	set_base(current->ldt[2],base);
+	wake_up(&current->vfork_parent);
+}
+
+#define CLONE_VFORK	1	/* see sys_vfork in system_call.s */
+
 /*
  *  Ok, this is the main fork-routine. It copies the system process
  * information (task[nr]) and sets up the necessary registers. It
- * also copies the data segment in it's entirety.
+ * also copies the data segment in it's entirety - except for vfork(),
+ * where the child borrows it and we sleep until it is given back.
  */
-int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
+int copy_process(long clone_flags,int nr,long ebp,long edi,long esi,long gs,long none,
 		long ebx,long ecx,long edx,
 		long fs,long es,long ds,
 		long eip,long cs,long eflags,long esp,long ss)
@@ -73,25 +100,34 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	struct task_struct *p;
 	int i;
 	struct file *f;
+#ifndef HW_TASK_SWITCH
+	long * sp;
+#endif
 
-	p = (struct task_struct *) get_free_page();
-	if (!p)
-		return -EAGAIN;
-	task[nr] = p;
+	p = task[nr];		/* reserved by find_empty_process() */
+	i = p->pid;
 	*p = *current;	/* NOTE! this doesn't copy the supervisor stack */
 	p->state = TASK_UNINTERRUPTIBLE;
-	p->pid = last_pid;
+	p->pid = i;
 	p->father = current->pid;
 	p->counter = p->priority;
 	p->signal = 0;
 	p->alarm = 0;
+	init_timer(&p->real_timer);
+	p->it_real.pending = 0;
+	p->it_real_sec = p->it_real_nsec = 0;
 	p->leader = 0;		/* process leadership doesn't inherit */
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
 	p->start_time = jiffies;
+	p->nvcsw = p->nivcsw = 0;
+	p->run_delay = p->sleep_time = p->isleep_time = 0;
+	p->sched_stamp = jiffies;
+	p->vfork_parent = (clone_flags & CLONE_VFORK) ? current : NULL;
 	p->tss.back_link = 0;
 	p->tss.esp0 = PAGE_SIZE + (long) p;
 	p->tss.ss0 = 0x10;
+#ifdef HW_TASK_SWITCH
 	p->tss.eip = eip;
 	p->tss.eflags = eflags;
 	p->tss.eax = 0;
@@ -108,11 +144,39 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->tss.ds = ds & 0xffff;
 	p->tss.fs = fs & 0xffff;
 	p->tss.gs = gs & 0xffff;
+#else
+/*
+ * The child starts out in ret_from_fork, with a kernel stack that
+ * looks like the parent's did in system_call (with eax=0), under the
+ * registers switch_to() pops.
+ */
+	sp = (long *) (PAGE_SIZE + (long) p);
+	*--sp = ss & 0xffff;
+	*--sp = esp;
+	*--sp = eflags;
+	*--sp = cs & 0xffff;
+	*--sp = eip;
+	*--sp = ds & 0xffff;
+	*--sp = es & 0xffff;
+	*--sp = fs & 0xffff;
+	*--sp = edx;
+	*--sp = ecx;
+	*--sp = ebx;
+	*--sp = 0;
+	*--sp = ebp;
+	*--sp = esi;
+	*--sp = edi;
+	*--sp = ebx;
+	*--sp = 0x17;
+	*--sp = gs & 0xffff;
+	p->tss.esp = (long) sp;
+	p->tss.eip = (long) ret_from_fork;
+#endif
 	p->tss.ldt = _LDT(nr);
 	p->tss.trace_bitmap = 0x80000000;
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0"::"m" (p->tss.i387));
-	if (copy_mem(nr,p)) {
+	if (!(clone_flags & CLONE_VFORK) && copy_mem(nr,p)) {
 		task[nr] = NULL;
 		free_page((long) p);
 		return -EAGAIN;
@@ -126,22 +190,50 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		current->root->i_count++;
 	if (current->executable)
 		current->executable->i_count++;
+	add_exec_task(p);
+	sched_fork(p);
+#ifdef HW_TASK_SWITCH
 	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY,&(p->tss));
+#endif
 	set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,&(p->ldt));
 	p->state = TASK_RUNNING;	/* do this last, just in case */
-	return last_pid;
+	if (clone_flags & CLONE_VFORK) {
+		i = p->pid;
+		cli();
+		while (p->vfork_parent == current) {
+			current->state = TASK_UNINTERRUPTIBLE;
+			schedule();
+		}
+		sti();
+		return i;
+	}
+	return p->pid;
 }
 
+/*
+ * Find a free slot and a pid for a new task, and reserve them with the
+ * page its task_struct goes in: getting the page may sleep (to swap),
+ * and another fork mustn't get the same ones meanwhile. The reservation
+ * is an empty task, asleep, for copy_process() to fill in.
+ */
 int find_empty_process(void)
 {
+	struct task_struct * p;
 	int i;
 
+	if (!(p = (struct task_struct *) get_free_page()))
+		return -EAGAIN;
 	repeat:
 		if ((++last_pid)<0) last_pid=1;
 		for(i=0 ; i<NR_TASKS ; i++)
 			if (task[i] && task[i]->pid == last_pid) goto repeat;
 	for(i=1 ; i<NR_TASKS ; i++)
-		if (!task[i])
+		if (!task[i]) {
+			p->state = TASK_UNINTERRUPTIBLE;
+			p->pid = last_pid;
+			task[i] = p;
 			return i;
+		}
+	free_page((long) p);
 	return -EAGAIN;
 }
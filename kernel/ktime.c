@@ -0,0 +1,151 @@
+/*
+ *  linux/kernel/ktime.c
+ *
+ * The TSC clocksource: calibration against the PIT, and the ktime and
+ * gettimeofday() time bases on top of it.
+ */
+
+#include <sys/time.h>
+#include <sys/vtime.h>
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <asm/io.h>
+
+#define CALIBRATE_MS	50
+#define CALIBRATE_LATCH	(1193180*CALIBRATE_MS/1000)
+#define CYC2NS_SHIFT	22
+
+unsigned long tsc_khz = 0;
+static unsigned long cyc2ns_mult = 0;	/* ns per cycle << CYC2NS_SHIFT */
+static cycles_t tsc_base = 0;
+
+unsigned long vtime_page = 0;
+
+/*
+ * cpuid level 1 feature flags, or 0 if there is no cpuid.
+ */
+unsigned long cpu_features(void)
+{
+	unsigned long f1, f2, eax, edx;
+
+	__asm__("pushfl\n\t"			/* can we toggle EFLAGS.ID? */
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"movl %0,%1\n\t"
+		"xorl $0x200000,%0\n\t"
+		"pushl %0\n\t"
+		"popfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"popfl"
+		:"=&r" (f1),"=&r" (f2));
+	if (!((f1 ^ f2) & 0x200000))
+		return 0;			/* no cpuid, a 386 or old 486 */
+	__asm__("cpuid":"=a" (eax),"=d" (edx):"0" (1):"bx","cx");
+	if ((eax & 0xf00) == 0x600 && (eax & 0xff) < 0x33)
+		edx &= ~CPU_SEP;	/* early Pentium Pro: SEP is bogus */
+	return edx;
+}
+
+/*
+ * Count TSC cycles over CALIBRATE_MS of PIT channel 2 (the speaker
+ * timer, with the speaker itself left off) and work out the frequency.
+ * Channel 0 and its interrupt are not touched.
+ */
+void calibrate_tsc(void)
+{
+	unsigned long start, end;
+	cycles_t t;
+	unsigned char port;
+
+	if (!(cpu_features() & CPU_TSC)) {
+		printk("No TSC, time is kept in jiffies\n\r");
+		return;
+	}
+	port = inb(0x61);
+	outb((port & ~0x02) | 0x01,0x61);	/* gate high, speaker off */
+	outb(0xb0,0x43);			/* binary, mode 0, LSB/MSB, ch 2 */
+	outb(CALIBRATE_LATCH & 0xff,0x42);
+	outb(CALIBRATE_LATCH >> 8,0x42);
+	t = get_cycles();
+	start = t;
+	while (!(inb(0x61) & 0x20))
+		/* nothing */;
+	t = get_cycles();
+	end = t;
+	outb(port,0x61);
+	tsc_khz = (end - start) / CALIBRATE_MS;
+	if (!tsc_khz)
+		return;
+	t = 1000000ULL << CYC2NS_SHIFT;
+	do_div(t,tsc_khz);
+	cyc2ns_mult = t;
+	tsc_base = get_cycles();
+	printk("TSC: %d.%03d MHz\n\r",tsc_khz/1000,tsc_khz%1000);
+}
+
+/*
+ * Done in two 32-bit halves so that the product can't overflow.
+ */
+ktime_t cycles_to_ns(cycles_t cycles)
+{
+	unsigned long lo = cycles, hi = cycles >> 32;
+
+	return (((ktime_t) lo * cyc2ns_mult) >> CYC2NS_SHIFT) +
+		(((ktime_t) hi * cyc2ns_mult) << (32 - CYC2NS_SHIFT));
+}
+
+ktime_t ktime_get(void)
+{
+	if (!tsc_khz)
+		return (ktime_t) jiffies * (1000000000/HZ);
+	return cycles_to_ns(get_cycles() - tsc_base);
+}
+
+void do_gettimeofday(struct timeval * tv)
+{
+	ktime_t ns = ktime_get();
+	unsigned long rem;
+
+	rem = do_div(ns,1000000000);
+	tv->tv_sec = startup_time + (long) ns;
+	tv->tv_usec = rem / 1000;
+}
+
+/*
+ * Called on every tick, and after the time is set. The sequence count
+ * guards against a user program reading the page halfway through.
+ */
+void update_vtime(void)
+{
+	struct vtime * vt = (struct vtime *) vtime_page;
+	struct timeval tv;
+
+	if (!vt)
+		return;
+	vt->seq++;
+	__asm__ __volatile__("":::"memory");
+	do_gettimeofday(&tv);
+	vt->tsc_stamp = tsc_khz ? get_cycles() : 0;
+	vt->jiffies = jiffies;
+	vt->tv_sec = tv.tv_sec;
+	vt->tv_usec = tv.tv_usec;
+	__asm__ __volatile__("":::"memory");
+	vt->seq++;
+}
+
+void vtime_init(void)
+{
+	struct vtime * vt;
+
+	if (!(vtime_page = get_free_page()))
+		panic("Unable to get time page");
+	vt = (struct vtime *) vtime_page;
+	vt->hz = HZ;
+	vt->tsc_khz = tsc_khz;
+	vt->cyc2ns_mult = cyc2ns_mult;
+	vt->cyc2ns_shift = CYC2NS_SHIFT;
+	update_vtime();
+}
@@ -0,0 +1,98 @@
+/*
+ *  linux/kernel/mutex.c
+ *
+ * Sleeping locks for buffers, inodes and super-blocks.
+ */
+
+/*
+ * mutex.c implements the sleeping locks used for buffers, inodes and
+ * super-blocks, which used to be open-coded as 'while (x->lock)
+ * sleep_on()' loops. Lockers sleep exclusively, so an unlock wakes
+ * one of them (and everybody in mutex_wait()). All of it may be called
+ * with interrupts disabled, and mutex_unlock() from an interrupt.
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/mutex.h>
+#include <asm/system.h>
+
+void mutex_init(struct mutex * m)
+{
+	m->locked = 0;
+	m->owner = NULL;
+	m->wait = NULL;
+	m->acquired = m->contended = m->wait_time = 0;
+}
+
+void mutex_lock(struct mutex * m)
+{
+	unsigned long flags, start;
+
+	save_flags(flags);
+	cli();
+	m->acquired++;
+	if (m->locked) {
+		m->contended++;
+		start = jiffies;
+		while (m->locked)
+			sleep_on_queue_exclusive(&m->wait);
+		m->wait_time += jiffies - start;
+	}
+	m->locked = 1;
+	m->owner = current;
+	restore_flags(flags);
+}
+
+void mutex_unlock(struct mutex * m)
+{
+	m->locked = 0;
+	m->owner = NULL;
+	wake_up_queue(&m->wait);
+}
+
+/*
+ * Wait for the lock to be released, without taking it.
+ */
+void mutex_wait(struct mutex * m)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	while (m->locked)
+		sleep_on_queue(&m->wait);
+	restore_flags(flags);
+}
+
+/*
+ * Buffer heads are recycled all the time, so their counters are only
+ * interesting summed up. Inodes and super-blocks are listed one by one
+ * if they have ever been contended.
+ */
+void show_lock_stat(void)
+{
+	struct buffer_head * bh;
+	struct m_inode * inode;
+	struct super_block * sb;
+	unsigned long acquired = 0, contended = 0, wait_time = 0;
+	int i;
+
+	for (i=0, bh=start_buffer ; i<NR_BUFFERS ; i++,bh++) {
+		acquired += bh->b_mutex.acquired;
+		contended += bh->b_mutex.contended;
+		wait_time += bh->b_mutex.wait_time;
+	}
+	printk("buffers: %d locks, %d contended, %d jiffies waited\n\r",
+		acquired,contended,wait_time);
+	for (inode=inode_table ; inode<inode_table+NR_INODE ; inode++)
+		if (inode->i_mutex.contended)
+			printk("inode %04x:%d: %d locks, %d contended, %d jiffies waited\n\r",
+				inode->i_dev,inode->i_num,inode->i_mutex.acquired,
+				inode->i_mutex.contended,inode->i_mutex.wait_time);
+	for (sb=super_block ; sb<super_block+NR_SUPER ; sb++)
+		if (sb->s_mutex.contended)
+			printk("super %04x: %d locks, %d contended, %d jiffies waited\n\r",
+				sb->s_dev,sb->s_mutex.acquired,
+				sb->s_mutex.contended,sb->s_mutex.wait_time);
+}
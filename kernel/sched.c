@@ -148,6 +148,12 @@
  *
  */
 #include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/vtime.h>
+#include <linux/interrupt.h>
+#include <linux/ktime.h>
 
 //
 // _S(nr) используется для представления сигналов в виде битов (битовых флагов).
@@ -227,6 +233,16 @@ void show_task(int nr,struct task_struct * p) // nr – номер задачи
 	printk("%d (of %d) chars free in kernel stack\n\r",i,j);
 }
 
+#ifdef SWITCH_BENCH
+/*
+ * Cycles from just before switch_to() in the old task to just after
+ * it in the new one. A new task starts in ret_from_fork instead, so
+ * the stamp is rewritten by every schedule() to not count that.
+ */
+static unsigned long switch_tsc = 0;
+static unsigned long switch_cycles = 0, switch_count = 0;
+#endif
+
 //
 // Эта функция show_stat() предназначена для вывода информации о всех активных процессах в системе.
 // Она проходит по массиву task[], в котором хранятся все процессы, и вызывает show_task() для каждого существующего процесса.
@@ -245,6 +261,12 @@ void show_stat(void)
 	for (i=0;i<NR_TASKS;i++)      // Проходим по всем слотам задач
 		if (task[i])              // Если процесс существует
 			show_task(i,task[i]); // Выводим информацию о нём
+	show_lock_stat();
+#ifdef SWITCH_BENCH
+	if (switch_count)
+		printk("%d task switches, %d cycles each\n\r",
+			switch_count,switch_cycles/switch_count);
+#endif
 	/*
 	* Пример вывода show_stat()
 	*
@@ -452,6 +474,7 @@ extern int timer_interrupt(void);
  * 
  */
 extern int system_call(void);
+extern int sysenter_entry(void);
 
 union task_union {
 	struct task_struct task;
@@ -467,6 +490,8 @@ struct task_struct *last_task_used_math = NULL;
 
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
 
+int sched_mode = SCHED_MODE_COUNTER;
+
 long user_stack [ PAGE_SIZE>>2 ] ;
 
 struct {
@@ -494,6 +519,170 @@ void math_state_restore()
 	}
 }
 
+/*
+ * The fair scheduler. Every task has a virtual runtime that grows by
+ * FAIR_UNIT*FAIR_WEIGHT0/priority each tick it runs, so 'nice' still
+ * decides how big a share a task gets. On top of that the session of
+ * the task gets FAIR_UNIT per tick: we first pick the runnable session
+ * that has had the least cpu, and then the task within it that has had
+ * the least. Sleepers are pulled up to within FAIR_SLACK of the minimum
+ * when they wake, so they can't save up time while sleeping.
+ *
+ * Virtual times are allowed to wrap, so compare them with vtime_before.
+ */
+#define FAIR_UNIT	1024
+#define FAIR_WEIGHT0	15		/* priority of a default task */
+#define FAIR_SLICE	5		/* ticks a task runs before re-pick */
+#define FAIR_SLACK	(FAIR_UNIT*FAIR_SLICE)
+
+#define vtime_before(a,b) ((long)((a)-(b)) < 0)
+
+static struct sched_group sched_group[NR_TASKS];
+static unsigned long fair_min_vruntime = 0;
+
+static struct sched_group * get_sched_group(long session)
+{
+	struct sched_group * g, * free = NULL;
+
+	for (g = sched_group ; g < sched_group+NR_TASKS ; g++) {
+		if (!g->count) {
+			if (!free)
+				free = g;
+		} else if (g->session == session) {
+			g->count++;
+			return g;
+		}
+	}
+	if (!free)
+		panic("No free scheduler groups");
+	free->session = session;
+	free->count = 1;
+	free->vruntime = fair_min_vruntime;
+	free->min_vruntime = current->vruntime;
+	return free;
+}
+
+static inline void put_sched_group(struct sched_group * g)
+{
+	if (g)
+		g->count--;
+}
+
+void sched_fork(struct task_struct * p)
+{
+	p->group = get_sched_group(p->session);
+}
+
+void sched_exit(struct task_struct * p)
+{
+	put_sched_group(p->group);
+	p->group = NULL;
+}
+
+void sched_setsid(struct task_struct * p)
+{
+	put_sched_group(p->group);
+	p->group = get_sched_group(p->session);
+}
+
+static inline void fair_tick(void)
+{
+	if (!current->group)
+		return;
+	current->vruntime += FAIR_UNIT*FAIR_WEIGHT0/current->priority;
+	current->group->vruntime += FAIR_UNIT;
+}
+
+static int fair_pick(void)
+{
+	int i,next = 0;
+	struct task_struct ** p, * t, * best = NULL;
+	struct sched_group * g;
+
+	i = NR_TASKS;
+	p = &task[NR_TASKS];
+	while (--i) {
+		if (!(t = *--p) || t->state != TASK_RUNNING || !(g = t->group))
+			continue;
+		if (vtime_before(g->vruntime, fair_min_vruntime - FAIR_SLACK))
+			g->vruntime = fair_min_vruntime - FAIR_SLACK;
+		if (vtime_before(t->vruntime, g->min_vruntime - FAIR_SLACK))
+			t->vruntime = g->min_vruntime - FAIR_SLACK;
+		if (!best || vtime_before(g->vruntime, best->group->vruntime) ||
+		    (g == best->group && vtime_before(t->vruntime, best->vruntime)))
+			best = t, next = i;
+	}
+	if (!best)
+		return 0;
+	g = best->group;
+	if (vtime_before(fair_min_vruntime, g->vruntime))
+		fair_min_vruntime = g->vruntime;
+	if (vtime_before(g->min_vruntime, best->vruntime))
+		g->min_vruntime = best->vruntime;
+	if (best->counter <= 0)
+		best->counter = FAIR_SLICE;
+	return next;
+}
+
+/*
+ * Real-time tasks (SCHED_FIFO and SCHED_RR) always go before the others,
+ * highest rt_priority first. A FIFO task runs until it sleeps or a
+ * higher priority task wakes up; an RR task also gives up the cpu to
+ * its equals after RR_SLICE ticks. Among equals we start looking at the
+ * slot after current, which is what makes RR round-robin.
+ *
+ * Returns -1 if there is no runnable real-time task.
+ */
+#define RR_SLICE	10
+
+#define rt_prio(p) ((p)->policy == SCHED_OTHER ? 0 : (p)->rt_priority)
+
+static int rt_pick(void)
+{
+	int i,n,next = -1;
+	long prio = 0;
+	struct task_struct * p;
+
+	for (n = 0 ; n < NR_TASKS ; n++)
+		if (task[n] == current)
+			break;
+	if (rt_prio(current) && current->state == TASK_RUNNING &&
+	    (current->policy == SCHED_FIFO || current->counter > 0))
+		prio = current->rt_priority, next = n;
+	for (i = 1 ; i <= NR_TASKS ; i++) {
+		if (!(p = task[(n+i) % NR_TASKS]))
+			continue;
+		if (p->state == TASK_RUNNING && rt_prio(p) > prio)
+			prio = p->rt_priority, next = (n+i) % NR_TASKS;
+	}
+	if (next >= 0 && task[next]->counter <= 0)
+		task[next]->counter = RR_SLICE;
+	return next;
+}
+
+/*
+ * Wake up a task, and if it is a real-time task that outranks the
+ * current one, make sure we reschedule as soon as possible: a zero
+ * counter is picked up by do_timer(), the system-call return path and
+ * the serial interrupt. 'sched_stamp' is when the task was switched
+ * out (or in), so the difference is the time it slept.
+ */
+int need_resched = 0;
+
+static inline void wake_task(struct task_struct * p)
+{
+	if (p->state == TASK_UNINTERRUPTIBLE) {
+		p->sleep_time += jiffies - p->sched_stamp;
+		p->sched_stamp = jiffies;
+	} else if (p->state == TASK_INTERRUPTIBLE) {
+		p->isleep_time += jiffies - p->sched_stamp;
+		p->sched_stamp = jiffies;
+	}
+	p->state = TASK_RUNNING;
+	if (rt_prio(p) > rt_prio(current))
+		current->counter = 0, need_resched = 1;
+}
+
 /*
  *  'schedule()' is the scheduler function. This is GOOD CODE! There
  * probably won't be any reason to change this, as it should work well
@@ -509,22 +698,24 @@ void schedule(void)
 	int i,next,c;
 	struct task_struct ** p;
 
-/* check alarm, wake up any interruptible tasks that have got a signal */
-
-	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
-		if (*p) {
-			if ((*p)->alarm && (*p)->alarm < jiffies) {
-					(*p)->signal |= (1<<(SIGALRM-1));
-					(*p)->alarm = 0;
-				}
-			if (((*p)->signal & ~(_BLOCKABLE & (*p)->blocked)) &&
-			(*p)->state==TASK_INTERRUPTIBLE)
-				(*p)->state=TASK_RUNNING;
-		}
+/*
+ * Alarms are timers and signals wake their target when they are sent,
+ * so the only thing to check here is that we don't go to sleep
+ * interruptibly with a signal already pending.
+ */
+	if (current->state == TASK_INTERRUPTIBLE &&
+	    (current->signal & ~(_BLOCKABLE & current->blocked)))
+		current->state = TASK_RUNNING;
 
 /* this is the scheduler proper: */
 
-	while (1) {
+	need_resched = 0;
+
+	if ((next = rt_pick()) >= 0)
+		goto found;
+	if (sched_mode == SCHED_MODE_FAIR)
+		next = fair_pick();
+	else while (1) {
 		c = -1;
 		next = 0;
 		i = NR_TASKS;
@@ -541,11 +732,40 @@ void schedule(void)
 				(*p)->counter = ((*p)->counter >> 1) +
 						(*p)->priority;
 	}
+found:
+	if (task[next] != current) {
+		if (current->state == TASK_RUNNING)
+			current->nivcsw++;
+		else
+			current->nvcsw++;
+		current->sched_stamp = jiffies;
+		task[next]->run_delay += jiffies - task[next]->sched_stamp;
+		task[next]->sched_stamp = jiffies;
+	}
+#ifdef SWITCH_BENCH
+	switch_tsc = (task[next] != current) ? get_cycles() : 0;
 	switch_to(next);
+	if (switch_tsc) {
+		switch_cycles += (unsigned long) get_cycles() - switch_tsc;
+		switch_tsc = 0;
+		if (++switch_count & 0x10000) {
+			switch_cycles >>= 1;
+			switch_count >>= 1;
+		}
+	}
+#else
+	switch_to(next);
+#endif
 }
 
+static void cpu_idle(void);
+
 int sys_pause(void)
 {
+	if (current == FIRST_TASK) {
+		cpu_idle();
+		return 0;
+	}
 	current->state = TASK_INTERRUPTIBLE;
 	schedule();
 	return 0;
@@ -564,7 +784,7 @@ void sleep_on(struct task_struct **p)
 	current->state = TASK_UNINTERRUPTIBLE;
 	schedule();
 	if (tmp)
-		tmp->state=0;
+		wake_task(tmp);
 }
 
 void interruptible_sleep_on(struct task_struct **p)
@@ -580,22 +800,130 @@ void interruptible_sleep_on(struct task_struct **p)
 repeat:	current->state = TASK_INTERRUPTIBLE;
 	schedule();
 	if (*p && *p != current) {
-		(**p).state=0;
+		wake_task(*p);
 		goto repeat;
 	}
 	*p=NULL;
 	if (tmp)
-		tmp->state=0;
+		wake_task(tmp);
 }
 
 void wake_up(struct task_struct **p)
 {
 	if (p && *p) {
-		(**p).state=0;
+		wake_task(*p);
 		*p=NULL;
 	}
 }
 
+/*
+ * Wait queues. Unlike the sleep_on() chains above, every sleeper gets
+ * its own entry (on its kernel stack), so a wake-up can stop after the
+ * first 'exclusive' waiter instead of releasing everybody. Exclusive
+ * waiters are queued at the tail, shared ones at the head: a wake-up
+ * releases all shared waiters and at most one exclusive one. Woken
+ * entries are unlinked right away, so that two wake-ups in a row can't
+ * both pick the same task.
+ */
+static void add_wait_queue(struct wait_queue ** q, struct wait_queue * wait)
+{
+	if (!wait->exclusive) {
+		wait->next = *q;
+		*q = wait;
+		return;
+	}
+	while (*q)
+		q = &(*q)->next;
+	wait->next = NULL;
+	*q = wait;
+}
+
+static void remove_wait_queue(struct wait_queue ** q, struct wait_queue * wait)
+{
+	while (*q) {
+		if (*q == wait) {
+			*q = wait->next;
+			return;
+		}
+		q = &(*q)->next;
+	}
+}
+
+static void __sleep_on_queue(struct wait_queue ** q, int exclusive)
+{
+	struct wait_queue wait;
+	unsigned long flags;
+
+	if (!q)
+		return;
+	if (current == &(init_task.task))
+		panic("task[0] trying to sleep");
+	wait.task = current;
+	wait.exclusive = exclusive;
+	save_flags(flags);
+	cli();
+	add_wait_queue(q,&wait);
+	current->state = TASK_UNINTERRUPTIBLE;
+	schedule();
+	if (wait.task)
+		remove_wait_queue(q,&wait);
+	restore_flags(flags);
+}
+
+void sleep_on_queue(struct wait_queue ** q)
+{
+	__sleep_on_queue(q,0);
+}
+
+void sleep_on_queue_exclusive(struct wait_queue ** q)
+{
+	__sleep_on_queue(q,1);
+}
+
+static void __wake_up_queue(struct wait_queue ** q, int all)
+{
+	struct wait_queue * wait;
+	struct task_struct * p;
+	unsigned long flags;
+	int exclusive;
+
+	if (!q)
+		return;
+	save_flags(flags);
+	cli();
+	while ((wait = *q) != NULL) {
+		*q = wait->next;
+		p = wait->task;
+		exclusive = wait->exclusive;
+		wait->task = NULL;
+		wake_task(p);
+		if (exclusive && !all)
+			break;
+	}
+	restore_flags(flags);
+}
+
+void wake_up_queue(struct wait_queue ** q)
+{
+	__wake_up_queue(q,0);
+}
+
+void wake_up_queue_all(struct wait_queue ** q)
+{
+	__wake_up_queue(q,1);
+}
+
+/*
+ * Called whenever a signal has been posted to 'p': if it sleeps
+ * interruptibly and the signal isn't blocked, wake it up.
+ */
+void signal_wake_up(struct task_struct * p)
+{
+	if (p->state == TASK_INTERRUPTIBLE &&
+	    (p->signal & ~(_BLOCKABLE & p->blocked)))
+		wake_task(p);
+}
+
 /*
  * OK, here are some floppy things that shouldn't be in the kernel
  * proper. They are here because the floppy needs a timer, and this
@@ -664,42 +992,243 @@ void do_floppy_timer(void)
 	}
 }
 
-#define TIME_REQUESTS 64
+/*
+ * Tickless idle. The PIT normally runs in mode 2 (rate generator) and
+ * interrupts every LATCH counts. When task 0 finds nothing to do, it
+ * reprograms the PIT to interrupt only when the next timer is due (the
+ * 16-bit counter limits that to about 5 ticks), sets pit_ticks to the
+ * number of jiffies that interrupt stands for and halts. do_timer()
+ * then catches jiffies up and restores the normal period. If some other
+ * interrupt wakes us first, cpu_idle() works out how many ticks have
+ * really gone by from the PIT count and reloads it for the rest of the
+ * current tick.
+ */
+extern int beepcount;
 
-static struct timer_list {
-	long jiffies;
-	void (*fn)();
-	struct timer_list * next;
-} timer_list[TIME_REQUESTS], * next_timer = NULL;
+static int pit_reload = 0;		/* PIT isn't at LATCH */
+static long pit_ticks = 1;		/* jiffies the next interrupt is worth */
 
-void add_timer(long jiffies, void (*fn)(void))
+static inline void pit_load(unsigned int count)
 {
-	struct timer_list * p;
+	outb_p(0x34,0x43);		/* binary, mode 2, LSB/MSB, ch 0 */
+	outb_p(count & 0xff,0x40);	/* LSB */
+	outb(count >> 8,0x40);		/* MSB */
+}
+
+static inline unsigned int pit_read(void)
+{
+	unsigned int count;
 
-	if (!fn)
+	outb_p(0x00,0x43);		/* latch ch 0 */
+	count = inb_p(0x40);
+	count |= inb_p(0x40) << 8;
+	return count;
+}
+
+static inline int timer_irq_pending(void)
+{
+	outb_p(0x0a,0x20);		/* read IRR */
+	return inb_p(0x20) & 1;
+}
+
+/*
+ * High-resolution timers. When the first one is due before the next
+ * tick, hrtimer_program() "splits" the tick: the PIT is loaded to
+ * interrupt at the timer, with pit_ticks = 0 so that do_timer() knows
+ * no jiffy has passed, and pit_rest is loaded after that to finish the
+ * tick. Everything here runs with interrupts off.
+ */
+#define US_PER_TICK (1000000/HZ)
+#define HR_MIN 50			/* ~40us, shortest PIT interval */
+
+#define hr_before(j1,s1,j2,s2) \
+((long) ((j1)-(j2)) < 0 || ((j1) == (j2) && (s1) < (s2)))
+
+static struct hrtimer * hrtimer_list = NULL;
+static unsigned int pit_rest = 0;	/* counts to the tick after a split */
+
+static void hr_now(unsigned long * j, unsigned long * sub)
+{
+	unsigned int left;
+
+	*j = jiffies;
+	if (timer_irq_pending()) {	/* about to be caught up */
+		*sub = pit_ticks ? 0 : LATCH - pit_rest;
+		*j += pit_ticks;
+		return;
+	}
+	left = pit_read();
+	if (!pit_ticks)
+		left += pit_rest;
+	*sub = (left < LATCH) ? LATCH - left : 0;
+}
+
+static void hrtimer_program(void)
+{
+	struct hrtimer * t = hrtimer_list;
+	unsigned int left, now, d;
+
+	if (!t || pit_ticks > 1 || (long) (t->expires - jiffies) > 0)
+		return;
+	if (timer_irq_pending())
 		return;
+	left = pit_read();
+	if (!pit_ticks)
+		left += pit_rest;
+	now = (left < LATCH) ? LATCH - left : 0;
+	if (t->expires != jiffies || t->sub < now + HR_MIN)
+		d = HR_MIN;
+	else
+		d = t->sub - now;
+	if (d + HR_MIN >= left)
+		return;			/* the tick comes first anyway */
+	pit_load(d);
+	pit_rest = left - d;
+	pit_ticks = 0;
+	pit_reload = 1;
+}
+
+static void hrtimer_run(void)
+{
+	struct hrtimer * t;
+	unsigned long j, sub;
+
+	if (!hrtimer_list || (long) (hrtimer_list->expires - jiffies) > 0)
+		return;
+	hr_now(&j,&sub);
+	sub += HR_MIN;
+	while ((t = hrtimer_list) && !hr_before(j,sub,t->expires,t->sub)) {
+		hrtimer_list = t->next;
+		t->pending = 0;
+		(t->function)(t->data);
+	}
+	hrtimer_program();
+}
+
+static int hrtimer_unlink(struct hrtimer * timer)
+{
+	struct hrtimer ** p;
+
+	if (!timer->pending)
+		return 0;
+	for (p = &hrtimer_list ; *p ; p = &(*p)->next)
+		if (*p == timer) {
+			*p = timer->next;
+			break;
+		}
+	timer->pending = 0;
+	return 1;
+}
+
+/*
+ * Start (or restart) 'timer' to go off 'sec' seconds and 'nsec'
+ * nanoseconds from now.
+ */
+void hrtimer_start(struct hrtimer * timer, long sec, long nsec)
+{
+	struct hrtimer ** p;
+	unsigned long flags, j, sub, us;
+
+	if (sec > 0x7fffffff / HZ / 2)
+		sec = 0x7fffffff / HZ / 2;
+	save_flags(flags);
+	cli();
+	hrtimer_unlink(timer);
+	hr_now(&j,&sub);
+	us = (nsec + 999) / 1000;
+	j += sec * HZ + us / US_PER_TICK;
+	sub += (us % US_PER_TICK) * LATCH / US_PER_TICK;
+	if (sub >= LATCH) {
+		sub -= LATCH;
+		j++;
+	}
+	timer->expires = j;
+	timer->sub = sub;
+	for (p = &hrtimer_list ; *p ; p = &(*p)->next)
+		if (hr_before(j,sub,(*p)->expires,(*p)->sub))
+			break;
+	timer->next = *p;
+	*p = timer;
+	timer->pending = 1;
+	if (hrtimer_list == timer)
+		hrtimer_program();
+	restore_flags(flags);
+}
+
+/*
+ * Returns 1 if the timer was still pending.
+ */
+int hrtimer_cancel(struct hrtimer * timer)
+{
+	unsigned long flags;
+	int ret;
+
+	save_flags(flags);
+	cli();
+	ret = hrtimer_unlink(timer);
+	restore_flags(flags);
+	return ret;
+}
+
+void hrtimer_left(struct hrtimer * timer, long * sec, long * nsec)
+{
+	unsigned long flags, j, sub;
+	long dj, ds;
+
+	*sec = *nsec = 0;
+	save_flags(flags);
 	cli();
-	if (jiffies <= 0)
-		(fn)();
-	else {
-		for (p = timer_list ; p < timer_list + TIME_REQUESTS ; p++)
-			if (!p->fn)
-				break;
-		if (p >= timer_list + TIME_REQUESTS)
-			panic("No more time requests free");
-		p->fn = fn;
-		p->jiffies = jiffies;
-		p->next = next_timer;
-		next_timer = p;
-		while (p->next && p->next->jiffies < p->jiffies) {
-			p->jiffies -= p->next->jiffies;
-			fn = p->fn;
-			p->fn = p->next->fn;
-			p->next->fn = fn;
-			jiffies = p->jiffies;
-			p->jiffies = p->next->jiffies;
-			p->next->jiffies = jiffies;
-			p = p->next;
+	if (timer->pending) {
+		hr_now(&j,&sub);
+		dj = timer->expires - j;
+		ds = timer->sub - sub;
+		if (ds < 0)
+			ds += LATCH, dj--;
+		if (dj >= 0) {
+			*sec = dj / HZ;
+			*nsec = ((dj % HZ) * US_PER_TICK +
+				ds * US_PER_TICK / LATCH) * 1000;
+		}
+	}
+	restore_flags(flags);
+}
+
+static void cpu_idle(void)
+{
+	struct task_struct ** p;
+	unsigned int count;
+	long n;
+
+	schedule();
+	refill_zero_pool();
+	merge_pages();
+	cli();
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->state == TASK_RUNNING) {
+			sti();
+			return;
+		}
+	if (!pit_reload && !beepcount && !(current_DOR & 0xf0)) {
+		count = pit_read();
+		n = 1 + (0xffff - count) / LATCH;
+		n = timer_ticks_left(n);
+		if (hrtimer_list && (long) (hrtimer_list->expires - jiffies) < n)
+			n = hrtimer_list->expires - jiffies;
+		if (n > 1) {
+			count += (n-1) * LATCH;
+			pit_load(count);
+			pit_ticks = n;
+			pit_reload = 1;
+		}
+	}
+	__asm__("sti ; hlt"::);
+	cli();
+	if (pit_reload && pit_ticks > 1) {
+		count = pit_read();
+		if (!timer_irq_pending()) {
+			jiffies += (pit_ticks - 1) - count / LATCH;
+			pit_load((count % LATCH) ? (count % LATCH) : LATCH);
+			pit_ticks = 1;
 		}
 	}
 	sti();
@@ -707,9 +1236,22 @@ void add_timer(long jiffies, void (*fn)(void))
 
 void do_timer(long cpl)
 {
-	extern int beepcount;
 	extern void sysbeepstop(void);
+	long ticks = pit_ticks;
 
+	if (pit_reload) {
+		if (ticks) {
+			pit_reload = 0;
+			pit_load(LATCH);
+		} else
+			pit_load(pit_rest);
+		pit_ticks = 1;
+	}
+	jiffies += ticks;
+	hrtimer_run();
+	if (!ticks)
+		return;			/* a split tick, see hrtimer_program() */
+	update_vtime();
 	if (beepcount)
 		if (!--beepcount)
 			sysbeepstop();
@@ -718,36 +1260,150 @@ void do_timer(long cpl)
 		current->utime++;
 	else
 		current->stime++;
+	if (sched_mode == SCHED_MODE_FAIR)
+		fair_tick();
 
-	if (next_timer) {
-		next_timer->jiffies--;
-		while (next_timer && next_timer->jiffies <= 0) {
-			void (*fn)(void);
-			
-			fn = next_timer->fn;
-			next_timer->fn = NULL;
-			next_timer = next_timer->next;
-			(fn)();
-		}
-	}
+	mark_bh(TIMER_BH);
 	if (current_DOR & 0xf0)
 		do_floppy_timer();
+	if (current->policy == SCHED_FIFO && current->counter > 0)
+		return;		/* only a higher priority wakeup preempts FIFO */
 	if ((--current->counter)>0) return;
 	current->counter=0;
-	if (!cpl) return;
+	if (!cpl) {
+		need_resched = 1;
+		return;
+	}
 	schedule();
 }
 
+static void alarm_timeout(unsigned long data)
+{
+	struct task_struct * p = (struct task_struct *) data;
+
+	p->alarm = 0;
+	p->signal |= (1<<(SIGALRM-1));
+	signal_wake_up(p);
+}
+
+/*
+ * Set the alarm of the current task to go off at 'when' (in jiffies),
+ * 0 cancels it.
+ */
+void set_alarm(long when)
+{
+	del_timer(&current->real_timer);
+	if ((current->alarm = when)) {
+		current->real_timer.expires = when;
+		current->real_timer.data = (unsigned long) current;
+		current->real_timer.function = alarm_timeout;
+		add_timer(&current->real_timer);
+	}
+}
+
 int sys_alarm(long seconds)
 {
 	int old = current->alarm;
 
 	if (old)
 		old = (old - jiffies) / HZ;
-	current->alarm = (seconds>0)?(jiffies+HZ*seconds):0;
+	set_alarm((seconds>0)?(jiffies+HZ*seconds):0);
 	return (old);
 }
 
+static void hrtimer_wakeup(unsigned long data)
+{
+	struct task_struct * p = (struct task_struct *) data;
+
+	if (p->state == TASK_INTERRUPTIBLE)
+		wake_task(p);
+}
+
+int sys_nanosleep(struct timespec * rqtp, struct timespec * rmtp)
+{
+	struct hrtimer timer = HRTIMER_INIT;
+	long sec, nsec;
+
+	sec = get_fs_long((unsigned long *) &rqtp->tv_sec);
+	nsec = get_fs_long((unsigned long *) &rqtp->tv_nsec);
+	if (sec < 0 || nsec < 0 || nsec >= 1000000000)
+		return -EINVAL;
+	timer.function = hrtimer_wakeup;
+	timer.data = (unsigned long) current;
+	cli();
+	hrtimer_start(&timer,sec,nsec);
+	while (timer.pending &&
+	       !(current->signal & ~(_BLOCKABLE & current->blocked))) {
+		current->state = TASK_INTERRUPTIBLE;
+		schedule();
+	}
+	sti();
+	if (!timer.pending)
+		return 0;
+	if (rmtp) {
+		hrtimer_left(&timer,&sec,&nsec);
+		verify_area(rmtp,sizeof *rmtp);
+		put_fs_long(sec,(unsigned long *) &rmtp->tv_sec);
+		put_fs_long(nsec,(unsigned long *) &rmtp->tv_nsec);
+	}
+	hrtimer_cancel(&timer);
+	return -EINTR;
+}
+
+static void it_real_fn(unsigned long data)
+{
+	struct task_struct * p = (struct task_struct *) data;
+
+	p->signal |= (1<<(SIGALRM-1));
+	signal_wake_up(p);
+	if (p->it_real_sec || p->it_real_nsec)
+		hrtimer_start(&p->it_real,p->it_real_sec,p->it_real_nsec);
+}
+
+/*
+ * Only ITIMER_REAL: there is no SIGVTALRM or SIGPROF to deliver for
+ * the other two.
+ */
+int sys_setitimer(int which, struct itimerval * value,
+	struct itimerval * ovalue)
+{
+	long sec, usec, isec, iusec;
+
+	if (which != ITIMER_REAL)
+		return -EINVAL;
+	if (!value)
+		return -EFAULT;
+	isec = get_fs_long((unsigned long *) &value->it_interval.tv_sec);
+	iusec = get_fs_long((unsigned long *) &value->it_interval.tv_usec);
+	sec = get_fs_long((unsigned long *) &value->it_value.tv_sec);
+	usec = get_fs_long((unsigned long *) &value->it_value.tv_usec);
+	if (sec < 0 || usec < 0 || usec >= 1000000 ||
+	    isec < 0 || iusec < 0 || iusec >= 1000000)
+		return -EINVAL;
+	if (ovalue) {
+		long osec, onsec;
+
+		hrtimer_left(&current->it_real,&osec,&onsec);
+		verify_area(ovalue,sizeof *ovalue);
+		put_fs_long(current->it_real_sec,
+			(unsigned long *) &ovalue->it_interval.tv_sec);
+		put_fs_long(current->it_real_nsec / 1000,
+			(unsigned long *) &ovalue->it_interval.tv_usec);
+		put_fs_long(osec,(unsigned long *) &ovalue->it_value.tv_sec);
+		put_fs_long(onsec / 1000,
+			(unsigned long *) &ovalue->it_value.tv_usec);
+	}
+	hrtimer_cancel(&current->it_real);
+	current->it_real_sec = isec;
+	current->it_real_nsec = iusec * 1000;
+	if (sec || usec) {
+		current->it_real.function = it_real_fn;
+		current->it_real.data = (unsigned long) current;
+		hrtimer_start(&current->it_real,sec,usec * 1000);
+	}
+	return 0;
+}
+
 int sys_getpid(void)
 {
 	return current->pid;
@@ -785,6 +1441,73 @@ int sys_nice(long increment)
 	return 0;
 }
 
+int sys_sched_setscheduler(int pid, int policy, int prio)
+{
+	struct task_struct ** p;
+
+	if (policy == SCHED_OTHER) {
+		if (prio)
+			return -EINVAL;
+	} else if (policy == SCHED_FIFO || policy == SCHED_RR) {
+		if (prio < 1 || prio > SCHED_MAX_PRIO)
+			return -EINVAL;
+		if (!suser())
+			return -EPERM;
+	} else
+		return -EINVAL;
+	if (!pid)
+		pid = current->pid;
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->pid == pid)
+			break;
+	if (p == &FIRST_TASK)
+		return -ESRCH;
+	if ((*p)->euid != current->euid && !suser())
+		return -EPERM;
+	(*p)->policy = policy;
+	(*p)->rt_priority = prio;
+	current->counter = 0;	/* re-pick on the way out */
+	return 0;
+}
+
+int sys_sched_getscheduler(int pid)
+{
+	struct task_struct ** p;
+
+	if (!pid)
+		return current->policy;
+	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->pid == pid)
+			return (*p)->policy;
+	return -ESRCH;
+}
+
+#define wrmsr(msr,lo,hi) \
+__asm__ __volatile__("wrmsr"::"c" (msr),"a" (lo),"d" (hi))
+
+/*
+ * sysenter always enters on the one stack in the SYSENTER_ESP msr, so
+ * that points at the esp0 that switch_to() keeps for the running task,
+ * and sysenter_entry loads the real stack from it. With hardware task
+ * switching every task has its own TSS, so it is left off.
+ *
+ * sysexit is not used: it loads flat user segments, while ours are
+ * based at nr*64MB in the LDT. System calls entered by sysenter
+ * return with iret like any other.
+ */
+static void sysenter_init(void)
+{
+#ifndef HW_TASK_SWITCH
+	if (!(cpu_features() & CPU_SEP))
+		return;
+	wrmsr(0x174,0x08,0);				/* SYSENTER_CS */
+	wrmsr(0x175,(long) &init_task.task.tss.esp0,0);	/* SYSENTER_ESP */
+	wrmsr(0x176,(long) &sysenter_entry,0);		/* SYSENTER_EIP */
+	if (vtime_page)
+		((struct vtime *) vtime_page)->features |= VTIME_SYSENTER;
+#endif
+}
+
 void sched_init(void)
 {
 	int i;
@@ -806,10 +1529,10 @@ void sched_init(void)
 	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
 	ltr(0);
 	lldt(0);
-	outb_p(0x36,0x43);		/* binary, mode 3, LSB/MSB, ch 0 */
-	outb_p(LATCH & 0xff , 0x40);	/* LSB */
-	outb(LATCH >> 8 , 0x40);	/* MSB */
+	pit_load(LATCH);
+	init_bh(TIMER_BH,run_timer_list);
 	set_intr_gate(0x20,&timer_interrupt);
 	outb(inb_p(0x21)&~0x01,0x21);
 	set_system_gate(0x80,&system_call);
+	sysenter_init();
 }
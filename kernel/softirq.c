@@ -0,0 +1,57 @@
+/*
+ *  linux/kernel/softirq.c
+ *
+ * Bottom halves: interrupt work run after the handler returns.
+ */
+
+/*
+ * softirq.c runs the bottom halves marked by interrupt handlers, see
+ * linux/interrupt.h. do_bottom_half() is called from the interrupt
+ * return paths (ret_from_sys_call, hd_interrupt, the keyboard and the
+ * serial interrupts) when something is marked.
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/interrupt.h>
+#include <asm/system.h>
+
+unsigned long bh_active = 0;
+unsigned long bh_mask = 0;
+struct bh_struct bh_base[32];
+
+static int bh_running = 0;
+
+void init_bh(int nr, void (*routine)(void))
+{
+	bh_base[nr].routine = routine;
+	bh_mask |= 1 << nr;
+}
+
+/*
+ * An interrupt that comes in while bottom halves are running just
+ * marks its own, and the loop here picks it up.
+ */
+void do_bottom_half(void)
+{
+	unsigned long flags, active;
+	int nr;
+
+	save_flags(flags);
+	cli();
+	if (bh_running) {
+		restore_flags(flags);
+		return;
+	}
+	bh_running = 1;
+	sti();
+	while ((active = bh_active & bh_mask) != 0)
+		for (nr = 0 ; active ; nr++, active >>= 1)
+			if (active & 1) {
+				__asm__ __volatile__("btrl %1,%0"
+					:"=m" (bh_active):"r" (nr));
+				bh_base[nr].routine();
+			}
+	cli();
+	bh_running = 0;
+	restore_flags(flags);
+}
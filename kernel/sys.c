@@ -11,11 +11,23 @@
 #include <linux/kernel.h>
 #include <asm/segment.h>
 #include <sys/times.h>
+#include <sys/timeb.h>
+#include <sys/time.h>
+#include <sys/vtime.h>
+#include <linux/ktime.h>
 #include <sys/utsname.h>
 
-int sys_ftime()
+int sys_ftime(struct timeb * tp)
 {
-	return -ENOSYS;
+	struct timeval tv;
+
+	do_gettimeofday(&tv);
+	verify_area(tp,sizeof *tp);
+	put_fs_long(tv.tv_sec,(unsigned long *)&tp->time);
+	put_fs_word(tv.tv_usec / 1000,(short *)&tp->millitm);
+	put_fs_word(0,&tp->timezone);
+	put_fs_word(0,&tp->dstflag);
+	return 0;
 }
 
 int sys_break()
@@ -145,11 +157,30 @@ int sys_setuid(int uid)
 	return(sys_setreuid(uid, uid));
 }
 
+int sys_gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+	struct timeval now;
+
+	if (tv) {
+		do_gettimeofday(&now);
+		verify_area(tv,sizeof *tv);
+		put_fs_long(now.tv_sec,(unsigned long *)&tv->tv_sec);
+		put_fs_long(now.tv_usec,(unsigned long *)&tv->tv_usec);
+	}
+	if (tz) {
+		verify_area(tz,sizeof *tz);
+		put_fs_long(0,(unsigned long *)&tz->tz_minuteswest);
+		put_fs_long(0,(unsigned long *)&tz->tz_dsttime);
+	}
+	return 0;
+}
+
 int sys_stime(long * tptr)
 {
 	if (!suser())
 		return -EPERM;
 	startup_time = get_fs_long((unsigned long *)tptr) - jiffies/HZ;
+	update_vtime();
 	return 0;
 }
 
@@ -165,10 +196,39 @@ int sys_times(struct tms * tbuf)
 	return jiffies;
 }
 
+/*
+ * Like times(), but for the scheduler: tells time spent waiting for
+ * the cpu from time spent blocked. pid 0 means the current task.
+ */
+int sys_schedstat(int pid, struct schedstat * sbuf)
+{
+	struct task_struct ** p;
+	struct task_struct * t = current;
+
+	if (pid) {
+		for (p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+			if (*p && (*p)->pid == pid)
+				break;
+		if (p == &FIRST_TASK)
+			return -ESRCH;
+		t = *p;
+	}
+	if (sbuf) {
+		verify_area(sbuf,sizeof *sbuf);
+		put_fs_long(t->nvcsw,&sbuf->nvcsw);
+		put_fs_long(t->nivcsw,&sbuf->nivcsw);
+		put_fs_long(t->run_delay,(unsigned long *)&sbuf->run_delay);
+		put_fs_long(t->sleep_time,(unsigned long *)&sbuf->sleep_time);
+		put_fs_long(t->isleep_time,(unsigned long *)&sbuf->isleep_time);
+	}
+	return jiffies;
+}
+
 int sys_brk(unsigned long end_data_seg)
 {
 	if (end_data_seg >= current->end_code &&
-	    end_data_seg < current->start_stack - 16384)
+	    end_data_seg < current->start_stack - 16384 &&
+	    end_data_seg < VTIME_ADDR)
 		current->brk = end_data_seg;
 	return current->brk;
 }
@@ -210,6 +270,7 @@ int sys_setsid(void)
 	current->leader = 1;
 	current->session = current->pgrp = current->pid;
 	current->tty = -1;
+	sched_setsid(current);
 	return current->pgrp;
 }
 
@@ -58,15 +58,17 @@ sa_mask = 4
 sa_flags = 8
 sa_restorer = 12
 
-nr_system_calls = 72
+nr_system_calls = 80
 
 /*
  * Ok, I get parallel printer interrupts while using the floppy for some
  * strange reason. Urgel. Now I just ignore them.
  */
 .globl _system_call,_sys_fork,_timer_interrupt,_sys_execve
+.globl _sys_vfork
 .globl _hd_interrupt,_floppy_interrupt,_parallel_interrupt
-.globl _device_not_available, _coprocessor_error
+.globl _device_not_available, _coprocessor_error, _ret_from_fork
+.globl _sysenter_entry
 
 .align 2
 bad_sys_call:
@@ -76,6 +78,44 @@ bad_sys_call:
 reschedule:
 	pushl $ret_from_sys_call
 	jmp _schedule
+
+/*
+ * Fast system call entry. The user stub (see <unistd.h>) pushes its
+ * return address and points %ebp at it; sysenter arrives here with
+ * interrupts off on the stack in SYSENTER_ESP, which holds the esp0 of
+ * the current task. We build the same frame int 0x80 would have and
+ * go on as system_call, so the return is an ordinary iret.
+ */
+.align 2
+_sysenter_entry:
+	movl (%esp),%esp
+	pushl $0x17		# ss
+	pushl %ebp		# esp, past the return address
+	addl $4,(%esp)
+	pushfl
+	orl $0x200,(%esp)	# sysenter cleared IF
+	pushl $0x0f		# cs
+	pushl $0		# eip, filled in below
+	push %ds
+	push %es
+	push %fs
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+	movl $0x10,%edx
+	mov %dx,%ds
+	mov %dx,%es
+	movl $0x17,%edx
+	mov %dx,%fs
+	sti
+	movl %fs:(%ebp),%edx
+	movl %edx,0x18(%esp)	# eip
+	movl 8(%esp),%edx
+	cmpl $nr_system_calls-1,%eax
+	jbe do_sys_call
+	pushl $-1
+	jmp ret_from_sys_call
+
 .align 2
 _system_call:
 	cmpl $nr_system_calls-1,%eax
@@ -91,6 +131,7 @@ _system_call:
 	mov %dx,%es
 	movl $0x17,%edx		# fs points to local data space
 	mov %dx,%fs
+do_sys_call:
 	call _sys_call_table(,%eax,4)
 	pushl %eax
 	movl _current,%eax
@@ -99,7 +140,11 @@ _system_call:
 	cmpl $0,counter(%eax)		# counter
 	je reschedule
 ret_from_sys_call:
-	movl _current,%eax		# task[0] cannot have signals
+	movl _bh_mask,%eax		# run marked bottom halves first
+	andl _bh_active,%eax
+	je 2f
+	call _do_bottom_half
+2:	movl _current,%eax		# task[0] cannot have signals
 	cmpl _task,%eax
 	je 3f
 	cmpw $0x0f,CS(%esp)		# was old code segment supervisor ?
@@ -186,7 +231,6 @@ _timer_interrupt:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
-	incl _jiffies
 	movb $0x20,%al		# EOI to interrupt controller #1
 	outb %al,$0x20
 	movl CS(%esp),%eax
@@ -214,10 +258,40 @@ _sys_fork:
 	pushl %edi
 	pushl %ebp
 	pushl %eax
+	pushl $0		# clone_flags
 	call _copy_process
-	addl $20,%esp
+	addl $24,%esp
 1:	ret
 
+.align 2
+_sys_vfork:
+	call _find_empty_process
+	testl %eax,%eax
+	js 1f
+	push %gs
+	pushl %esi
+	pushl %edi
+	pushl %ebp
+	pushl %eax
+	pushl $1		# CLONE_VFORK
+	call _copy_process
+	addl $24,%esp
+1:	ret
+
+/*
+ * A new task is first switched to here, see copy_process(): pop what
+ * switch_to() would have and return to user mode like the parent.
+ */
+.align 2
+_ret_from_fork:
+	pop %gs
+	pop %fs
+	popl %ebx
+	popl %edi
+	popl %esi
+	popl %ebp
+	jmp ret_from_sys_call
+
 _hd_interrupt:
 	pushl %eax
 	pushl %ecx
@@ -241,7 +315,11 @@ _hd_interrupt:
 	movl $_unexpected_hd_interrupt,%edx
 1:	outb %al,$0x20
 	call *%edx		# "interesting" way of handling intr.
-	pop %fs
+	movl _bh_mask,%eax
+	andl _bh_active,%eax
+	je 1f
+	call _do_bottom_half
+1:	pop %fs
 	pop %es
 	pop %ds
 	popl %edx
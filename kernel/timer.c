@@ -0,0 +1,170 @@
+/*
+ *  linux/kernel/timer.c
+ *
+ * The kernel timers, kept in a hierarchical timing wheel.
+ */
+
+/*
+ * timer.c contains the kernel timers. They used to be a fixed table of
+ * 64 delta-sorted entries, which made add_timer() O(n) and panicked
+ * when the table was full. Now they are kept in a hierarchical timing
+ * wheel: tv1 has one slot for each of the next 256 ticks, and each of
+ * tv2-tv5 covers 64 times the range of the level below it. Adding or
+ * removing a timer is O(1), and so is expiring one: timers are only
+ * moved down a level ("cascaded") when the level below wraps around.
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/timer.h>
+#include <asm/system.h>
+
+#define TVN_BITS 6
+#define TVR_BITS 8
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVR_MASK (TVR_SIZE - 1)
+
+static struct timer_list * tv1[TVR_SIZE];
+static struct timer_list * tv2[TVN_SIZE];
+static struct timer_list * tv3[TVN_SIZE];
+static struct timer_list * tv4[TVN_SIZE];
+static struct timer_list * tv5[TVN_SIZE];
+
+/* the wheel has run all timers up to (but not including) this tick */
+static unsigned long timer_jiffies = 0;
+
+static void internal_add_timer(struct timer_list * timer)
+{
+	unsigned long expires = timer->expires;
+	unsigned long idx = expires - timer_jiffies;
+	struct timer_list ** vec;
+
+	if ((long) idx < 0)		/* already due: run it next tick */
+		vec = tv1 + (timer_jiffies & TVR_MASK);
+	else if (idx < TVR_SIZE)
+		vec = tv1 + (expires & TVR_MASK);
+	else if (idx < 1 << (TVR_BITS + TVN_BITS))
+		vec = tv2 + ((expires >> TVR_BITS) & TVN_MASK);
+	else if (idx < 1 << (TVR_BITS + 2*TVN_BITS))
+		vec = tv3 + ((expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK);
+	else if (idx < 1 << (TVR_BITS + 3*TVN_BITS))
+		vec = tv4 + ((expires >> (TVR_BITS + 2*TVN_BITS)) & TVN_MASK);
+	else
+		vec = tv5 + ((expires >> (TVR_BITS + 3*TVN_BITS)) & TVN_MASK);
+	if ((timer->next = *vec))
+		(*vec)->pprev = &timer->next;
+	*vec = timer;
+	timer->pprev = vec;
+}
+
+static inline void detach_timer(struct timer_list * timer)
+{
+	if ((*timer->pprev = timer->next))
+		timer->next->pprev = timer->pprev;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+void init_timer(struct timer_list * timer)
+{
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/*
+ * Adding a timer that is already pending just moves it to its new
+ * expiry time.
+ */
+void add_timer(struct timer_list * timer)
+{
+	if (!timer->function)
+		return;
+	cli();
+	if (timer_pending(timer))
+		detach_timer(timer);
+	internal_add_timer(timer);
+	sti();
+}
+
+/*
+ * Returns 1 if the timer was pending, 0 if it had already run (or was
+ * never added).
+ */
+int del_timer(struct timer_list * timer)
+{
+	int ret = 0;
+
+	cli();
+	if (timer_pending(timer)) {
+		detach_timer(timer);
+		ret = 1;
+	}
+	sti();
+	return ret;
+}
+
+static int cascade(struct timer_list ** tv, int index)
+{
+	struct timer_list * timer, * next;
+
+	timer = tv[index];
+	tv[index] = NULL;
+	for ( ; timer ; timer = next) {
+		next = timer->next;
+		internal_add_timer(timer);
+	}
+	return index;
+}
+
+#define INDEX(n) ((timer_jiffies >> (TVR_BITS + (n)*TVN_BITS)) & TVN_MASK)
+
+/*
+ * The timer bottom half. The wheel is only touched with interrupts
+ * off, but timer functions are called with them on, and may add or
+ * delete timers (also themselves) freely.
+ */
+void run_timer_list(void)
+{
+	struct timer_list * timer;
+	void (*fn)();
+	unsigned long data;
+	int index;
+
+	cli();
+	while ((long) (jiffies - timer_jiffies) >= 0) {
+		index = timer_jiffies & TVR_MASK;
+		if (!index &&
+		    !cascade(tv2,INDEX(0)) &&
+		    !cascade(tv3,INDEX(1)) &&
+		    !cascade(tv4,INDEX(2)))
+			cascade(tv5,INDEX(3));
+		timer_jiffies++;
+		while ((timer = tv1[index])) {
+			fn = timer->function;
+			data = timer->data;
+			detach_timer(timer);
+			sti();
+			fn(data);
+			cli();
+		}
+	}
+	sti();
+}
+
+/*
+ * Number of ticks (at most 'max') until the next timer has to run. Used
+ * by the idle task to decide how long it can leave the PIT alone. The
+ * tick on which tv2-tv5 cascade counts as an event as well.
+ */
+long timer_ticks_left(long max)
+{
+	unsigned long j;
+
+	for (j = timer_jiffies ; (long) (j - jiffies) < max ; j++)
+		if (tv1[j & TVR_MASK] || !(j & TVR_MASK))
+			break;
+	if ((long) (j - jiffies) < 1)
+		return 1;
+	return j - jiffies;
+}
@@ -76,8 +76,10 @@ static void die(char * str,long esp_ptr,long nr)
 			printk("%p ",get_seg_long(0x17,i+(long *)esp[3]));
 		printk("\n");
 	}
-	str(i);
-	printk("Pid: %d, process nr: %d\n\r",current->pid,0xffff & i);
+	for (i=0 ; i<NR_TASKS ; i++)
+		if (task[i] == current)
+			break;
+	printk("Pid: %d, process nr: %d\n\r",current->pid,i);
 	for(i=0;i<10;i++)
 		printk("%02x ",0xff & get_seg_byte(esp[1],(i+(char *)esp[0])));
 	printk("\n\r");
@@ -27,25 +27,16 @@
 #include <linux/sched.h>
 #include <linux/head.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 
 volatile void do_exit(long code);
 
-static inline volatile void oom(void)
+volatile void oom(void)
 {
 	printk("out of memory\n\r");
 	do_exit(SIGSEGV);
 }
 
-#define invalidate() \
-__asm__("movl %%eax,%%cr3"::"a" (0))
-
-/* these are not to be changed without changing head.s etc */
-#define LOW_MEM 0x100000
-#define PAGING_MEMORY (15*1024*1024)
-#define PAGING_PAGES (PAGING_MEMORY>>12)
-#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
-#define USED 100
-
 #define CODE_SPACE(addr) ((((addr)+4095)&~4095) < \
 current->start_code + current->end_code)
 
@@ -54,32 +45,211 @@ static long HIGH_MEMORY = 0;
 #define copy_page(from,to) \
 __asm__("cld ; rep ; movsl"::"S" (from),"D" (to),"c" (1024):"cx","di","si")
 
-static unsigned char mem_map [ PAGING_PAGES ] = {0,};
+unsigned char mem_map [ PAGING_PAGES ] = {0,};
+
+#define zero_pages(addr,n) \
+__asm__("cld ; rep ; stosl"::"a" (0),"D" (addr),"c" (1024*(n)):"cx","di")
+
+/*
+ * The buddy allocator. Free memory is kept in blocks of 2^order pages,
+ * aligned to their size (counted from LOW_MEM, which is aligned well
+ * beyond the largest block), one list per order. The list links live
+ * in the free pages themselves. free_order[] is order+1 for the first
+ * page of each free block and 0 everywhere else; mem_map[] stays 0 for
+ * every free page, so the reference counts work as they always did.
+ */
+struct free_block {
+	struct free_block * next, * prev;
+};
+
+static struct free_block free_area[MAX_ORDER];
+static int nr_free[MAX_ORDER];
+static unsigned char free_order [ PAGING_PAGES ] = {0,};
+
+#define BLOCK(nr) ((struct free_block *) (LOW_MEM + ((nr)<<12)))
+#define BLOCK_NR(b) MAP_NR((unsigned long) (b))
+
+static inline void add_block(unsigned long nr, int order)
+{
+	struct free_block * b = BLOCK(nr), * head = free_area + order;
+
+	b->next = head->next;
+	b->prev = head;
+	head->next->prev = b;
+	head->next = b;
+	free_order[nr] = order+1;
+	nr_free[order]++;
+}
+
+static inline void del_block(unsigned long nr, int order)
+{
+	struct free_block * b = BLOCK(nr);
+
+	b->prev->next = b->next;
+	b->next->prev = b->prev;
+	free_order[nr] = 0;
+	nr_free[order]--;
+}
+
+/*
+ * Give back a block whose pages have all dropped to zero references,
+ * merging it with its buddy for as long as that is free too.
+ */
+static void free_pages_block(unsigned long nr, int order)
+{
+	unsigned long buddy;
+
+	while (order < MAX_ORDER-1) {
+		buddy = nr ^ (1<<order);
+		if (buddy >= PAGING_PAGES || free_order[buddy] != order+1)
+			break;
+		del_block(buddy,order);
+		nr &= ~(1<<order);
+		order++;
+	}
+	add_block(nr,order);
+}
+
+/*
+ * Take a block of 2^order pages off the free lists. Called with
+ * interrupts off.
+ */
+static unsigned long alloc_block(int order)
+{
+	unsigned long nr;
+	int i;
+
+	for (i = order ; i < MAX_ORDER ; i++)
+		if (nr_free[i])
+			break;
+	if (i >= MAX_ORDER)
+		return 0;
+	nr = BLOCK_NR(free_area[i].next);
+	del_block(nr,i);
+	while (i > order) {		/* put back the upper halves */
+		i--;
+		add_block(nr + (1<<i),i);
+	}
+	for (i = 0 ; i < (1<<order) ; i++)
+		mem_map[nr+i] = 1;
+	return LOW_MEM + (nr<<12);
+}
+
+/*
+ * Pages cleared ahead of time by the idle task, so that the common
+ * get_free_page() need not clear one. They are allocated pages (with
+ * one reference) and go back to the free lists if memory runs out.
+ */
+#define ZERO_POOL 32
+
+static unsigned long zero_pool[ZERO_POOL];
+static int nr_zero = 0;
+
+static void drain_zero_pool(void)
+{
+	while (nr_zero) {
+		nr_zero--;
+		if (!--mem_map[MAP_NR(zero_pool[nr_zero])])
+			free_pages_block(MAP_NR(zero_pool[nr_zero]),0);
+	}
+}
+
+static unsigned long get_pages(int order)
+{
+	unsigned long flags, addr;
+
+	save_flags(flags);
+	cli();
+	if (!(addr = alloc_block(order)) && nr_zero) {
+		drain_zero_pool();
+		addr = alloc_block(order);
+	}
+	restore_flags(flags);
+	return addr;
+}
+
+/*
+ * Get 2^order physically contiguous pages, each with one reference,
+ * without clearing them: for callers that overwrite them anyway.
+ * Returns the physical address of the first, or 0. When memory is
+ * out, pages are swapped out until the block can be found: this may
+ * sleep, so the idle task (which can't) gets no such help.
+ */
+unsigned long __get_free_pages(int order)
+{
+	unsigned long addr;
+	int tries = 8 << order;
+
+	if (order < 0 || order >= MAX_ORDER)
+		return 0;
+	while (!(addr = get_pages(order)) && tries--)
+		if (current == task[0] || !swap_out())
+			break;
+	return addr;
+}
 
 /*
- * Get physical address of first (actually last :-) free page, and mark it
- * used. If no free pages left, return 0.
+ * As above, but the pages are zeroed.
+ */
+unsigned long get_free_pages(int order)
+{
+	unsigned long addr;
+
+	if ((addr = __get_free_pages(order)) != 0)
+		zero_pages(addr,1<<order);
+	return addr;
+}
+
+unsigned long __get_free_page(void)
+{
+	return __get_free_pages(0);
+}
+
+/*
+ * Get physical address of a free, zeroed page, and mark it used. If
+ * no free pages left, return 0.
  */
 unsigned long get_free_page(void)
 {
-register unsigned long __res asm("ax");
-
-__asm__("std ; repne ; scasb\n\t"
-	"jne 1f\n\t"
-	"movb $1,1(%%edi)\n\t"
-	"sall $12,%%ecx\n\t"
-	"addl %2,%%ecx\n\t"
-	"movl %%ecx,%%edx\n\t"
-	"movl $1024,%%ecx\n\t"
-	"leal 4092(%%edx),%%edi\n\t"
-	"rep ; stosl\n\t"
-	"movl %%edx,%%eax\n"
-	"1:"
-	:"=a" (__res)
-	:"0" (0),"i" (LOW_MEM),"c" (PAGING_PAGES),
-	"D" (mem_map+PAGING_PAGES-1)
-	:"di","cx","dx");
-return __res;
+	unsigned long flags, page = 0;
+
+	save_flags(flags);
+	cli();
+	if (nr_zero)
+		page = zero_pool[--nr_zero];
+	restore_flags(flags);
+	if (page)
+		return page;
+	return get_free_pages(0);
+}
+
+/*
+ * Called by the idle task with interrupts on. Memory is left alone
+ * when it gets tight, and the work stops as soon as somebody wants
+ * the cpu.
+ */
+void refill_zero_pool(void)
+{
+	unsigned long page;
+	int i, free;
+
+	while (nr_zero < ZERO_POOL && !need_resched) {
+		for (free = i = 0 ; i < MAX_ORDER ; i++)
+			free += nr_free[i] << i;
+		if (free < 2*ZERO_POOL)
+			return;
+		if (!(page = get_pages(0)))
+			return;
+		zero_pages(page,1);
+		cli();
+		if (nr_zero < ZERO_POOL) {
+			zero_pool[nr_zero++] = page;
+			page = 0;
+		}
+		sti();
+		if (page)
+			free_page(page);
+	}
 }
 
 /*
@@ -88,14 +258,49 @@ return __res;
  */
 void free_page(unsigned long addr)
 {
+	unsigned long flags;
+
 	if (addr < LOW_MEM) return;
 	if (addr >= HIGH_MEMORY)
 		panic("trying to free nonexistent page");
 	addr -= LOW_MEM;
 	addr >>= 12;
-	if (mem_map[addr]--) return;
-	mem_map[addr]=0;
-	panic("trying to free free page");
+	if (!mem_map[addr])
+		panic("trying to free free page");
+	save_flags(flags);
+	cli();
+	if (!--mem_map[addr])
+		free_pages_block(addr,0);
+	restore_flags(flags);
+}
+
+/*
+ * Drop a reference to each page of a block from get_free_pages(). The
+ * pages coalesce again as they become free.
+ */
+void free_pages(unsigned long addr, int order)
+{
+	int i;
+
+	for (i = 0 ; i < (1<<order) ; i++)
+		free_page(addr + (i<<12));
+}
+
+/*
+ * Drop everything a page table holds, and the table itself.
+ */
+static void free_table(unsigned long * pg_table)
+{
+	int nr;
+
+	for (nr=0 ; nr<1024 ; nr++) {
+		if (1 & pg_table[nr])
+			free_page(0xfffff000 & pg_table[nr]);
+		else if (pg_table[nr])
+			swap_free(pg_table[nr]);
+		pg_table[nr] = 0;
+	}
+	free_page((unsigned long) pg_table);
 }
 
 /*
@@ -105,7 +310,7 @@ void free_page(unsigned long addr)
 int free_page_tables(unsigned long from,unsigned long size)
 {
 	unsigned long *pg_table;
-	unsigned long * dir, nr;
+	unsigned long * dir;
 
 	if (from & 0x3fffff)
 		panic("free_page_tables called with wrong alignment");
@@ -117,14 +322,15 @@ int free_page_tables(unsigned long from,unsigned long size)
 		if (!(1 & *dir))
 			continue;
 		pg_table = (unsigned long *) (0xfffff000 & *dir);
-		for (nr=0 ; nr<1024 ; nr++) {
-			if (1 & *pg_table)
-				free_page(0xfffff000 & *pg_table);
-			*pg_table = 0;
-			pg_table++;
+		if ((unsigned long) pg_table >= LOW_MEM &&
+		    mem_map[MAP_NR((unsigned long) pg_table)] > 1) {
+			free_page((unsigned long) pg_table);	/* shared */
+			*dir = 0;
+			continue;
 		}
-		free_page(0xfffff000 & *dir);
+		free_table(pg_table);
 		*dir = 0;
+		cond_resched();
 	}
 	invalidate();
 	return 0;
@@ -146,6 +352,10 @@ int free_page_tables(unsigned long from,unsigned long size)
  * doesn't take any more memory - we don't copy-on-write in the low
  * 1 Mb-range, so the pages can be shared with the kernel. Thus the
  * special case for nr=xxxx.
+ *
+ * NOTE 3!! Any other fork doesn't copy the tables at all any more, it
+ * shares them copy-on-write, see unshare_table(). That is the only
+ * case which still copies pages here.
  */
 int copy_page_tables(unsigned long from,unsigned long to,long size)
 {
@@ -165,6 +375,12 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 			panic("copy_page_tables: already exist");
 		if (!(1 & *from_dir))
 			continue;
+		if (from) {		/* share the table, see unshare_table() */
+			*from_dir &= ~2;
+			*to_dir = *from_dir;
+			mem_map[MAP_NR(0xfffff000 & *from_dir)]++;
+			continue;
+		}
 		from_page_table = (unsigned long *) (0xfffff000 & *from_dir);
 		if (!(to_page_table = (unsigned long *) get_free_page()))
 			return -1;	/* Out of memory, see freeing */
@@ -183,11 +399,75 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 				mem_map[this_page]++;
 			}
 		}
+		cond_resched();
 	}
 	invalidate();
 	return 0;
 }
 
+/*
+ * fork doesn't copy page tables: parent and child point their directory
+ * entries at the same table, both read-only, and mem_map counts the
+ * directories using it. The pages in a shared table are counted once,
+ * for the table. The first write through a read-only directory entry
+ * (or a new page going into the table) comes here: the last user just
+ * gets its entry back writable, anyone else gets a copy, with every
+ * page in it write-protected and referenced once more.
+ *
+ * Getting pages may sleep, and the others may be gone when we wake up:
+ * then the table is ours after all, or (if the copy is under way) has
+ * to be let go of like free_page_tables() would.
+ */
+static void unshare_table(unsigned long * dir)
+{
+	unsigned long * from, * to, old, this_page;
+	int nr, lost = 0;
+
+	old = 0xfffff000 & *dir;
+	if (mem_map[MAP_NR(old)] == 1) {
+		*dir |= 2;
+		invalidate();
+		return;
+	}
+	if (!(to = (unsigned long *) __get_free_page()))
+		oom();
+	if (mem_map[MAP_NR(old)] == 1) {
+		free_page((unsigned long) to);
+		*dir |= 2;
+		invalidate();
+		return;
+	}
+	from = (unsigned long *) old;
+	for (nr = 0 ; nr < 1024 ; nr++) {
+		this_page = from[nr];
+		if (1 & this_page) {
+			this_page &= ~2;
+			from[nr] = this_page;
+			if ((this_page & 0xfffff000) >= LOW_MEM)
+				mem_map[MAP_NR(this_page & 0xfffff000)]++;
+		} else if (this_page) {
+			/* swapped out: the old table keeps the swap entry */
+			if (!(this_page = __get_free_page()))
+				oom();
+			if (swap_copy(from[nr],this_page)) {
+				free_page(this_page);
+				this_page = 0;
+				lost = 1;
+			} else
+				this_page |= PAGE_DIRTY | 7;
+		}
+		to[nr] = this_page;
+	}
+	*dir = ((unsigned long) to) | 7;
+	invalidate();
+	if (mem_map[MAP_NR(old)] == 1)
+		free_table(from);
+	else
+		mem_map[MAP_NR(old)]--;
+	if (lost)
+		do_exit(SIGBUS);
+}
+
 /*
  * This function puts a page in memory at the wanted address.
  * It returns the physical address of the page gotten, 0 if
@@ -205,9 +485,11 @@ unsigned long put_page(unsigned long page,unsigned long address)
 	if (mem_map[(page-LOW_MEM)>>12] != 1)
 		printk("mem_map disagrees with %p at %p\n",page,address);
 	page_table = (unsigned long *) ((address>>20) & 0xffc);
-	if ((*page_table)&1)
+	if ((*page_table)&1) {
+		if (!((*page_table)&2))
+			unshare_table(page_table);
 		page_table = (unsigned long *) (0xfffff000 & *page_table);
-	else {
+	} else {
 		if (!(tmp=get_free_page()))
 			return 0;
 		*page_table = tmp|7;
@@ -218,24 +500,90 @@ unsigned long put_page(unsigned long page,unsigned long address)
 	return page;
 }
 
+/*
+ * put_page() for a page the kernel filled in through its own mapping
+ * (exec's argument pages): the dirty bit tells swap_out() that it
+ * can't just be dropped and read in again.
+ */
+unsigned long put_dirty_page(unsigned long page,unsigned long address)
+{
+	unsigned long * page_table;
+
+	if (!put_page(page,address))
+		return 0;
+	page_table = (unsigned long *) (0xfffff000 &
+		*(unsigned long *) ((address>>20) & 0xffc));
+	page_table[(address>>12) & 0x3ff] |= PAGE_DIRTY;
+	return page;
+}
+
+/*
+ * Like put_page(), but for a page that is already in use: it gets
+ * another reference and is mapped read-only, so every task sees the
+ * same copy. Used for the time page and the zero page, which lives
+ * in the kernel, below LOW_MEM, and isn't counted.
+ */
+unsigned long put_shared_page(unsigned long page,unsigned long address)
+{
+	unsigned long tmp, *page_table;
+
+	if (!page || page >= HIGH_MEMORY)
+		return 0;
+	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	if ((*page_table)&1) {
+		if (!((*page_table)&2))
+			unshare_table(page_table);
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	} else {
+		if (!(tmp=get_free_page()))
+			return 0;
+		*page_table = tmp|7;
+		page_table = (unsigned long *) tmp;
+	}
+	if (page >= LOW_MEM)
+		mem_map[MAP_NR(page)]++;
+	page_table[(address>>12) & 0x3ff] = page | 5;
+	return page;
+}
+
+/*
+ * Getting the new page may sleep, and swap_out() may drop or swap out
+ * the old one meanwhile (here, or in the other task sharing it). So
+ * the entry is looked at again afterwards, and the old page let go of
+ * with free_page(): it may be the last reference by now.
+ */
 void un_wp_page(unsigned long * table_entry)
 {
-	unsigned long old_page,new_page;
+	unsigned long entry,old_page,new_page;
 
-	old_page = 0xfffff000 & *table_entry;
+repeat:
+	entry = *table_entry;
+	old_page = 0xfffff000 & entry;
+	if (old_page == vtime_page)
+		do_exit(SIGSEGV);	/* nobody gets a private clock */
 	if (old_page >= LOW_MEM && mem_map[MAP_NR(old_page)]==1) {
 		*table_entry |= 2;
 		invalidate();
 		return;
 	}
-	if (!(new_page=get_free_page()))
+	if (old_page == (unsigned long) empty_zero_page)
+		new_page = get_free_page();	/* nothing to copy */
+	else
+		new_page = __get_free_page();
+	if (!new_page)
 		oom();
-	if (old_page >= LOW_MEM)
-		mem_map[MAP_NR(old_page)]--;
-	*table_entry = new_page | 7;
+	if (*table_entry != entry) {
+		free_page(new_page);
+		if ((*table_entry & 3) == 1)	/* still present, read-only */
+			goto repeat;
+		return;
+	}
+	*table_entry = new_page | PAGE_DIRTY | 7;
 	invalidate();
-	copy_page(old_page,new_page);
-}	
+	if (old_page != (unsigned long) empty_zero_page)
+		copy_page(old_page,new_page);
+	free_page(old_page);
+}
 
 /*
  * This routine handles present pages, when users try to write
@@ -246,24 +594,35 @@ void un_wp_page(unsigned long * table_entry)
  */
 void do_wp_page(unsigned long error_code,unsigned long address)
 {
+	unsigned long * dir = (unsigned long *) ((address>>20) & 0xffc);
+	unsigned long * table_entry;
+
 #if 0
 /* we cannot do this yet: the estdio library writes to code space */
 /* stupid, stupid. I really want the libc.a from GNU */
 	if (CODE_SPACE(address))
 		do_exit(SIGSEGV);
 #endif
-	un_wp_page((unsigned long *)
-		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
-
+	if (!(*dir & 2))
+		unshare_table(dir);
+	table_entry = (unsigned long *)
+		(((address>>10) & 0xffc) + (0xfffff000 & *dir));
+	if (*table_entry & 2)
+		return;			/* the table was all it took */
+	un_wp_page(table_entry);
 }
 
 void write_verify(unsigned long address)
 {
+	unsigned long * dir = (unsigned long *) ((address>>20) & 0xffc);
 	unsigned long page;
 
-	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
+	if (!((page = *dir) & 1))
 		return;
+	if (!(page & 2)) {
+		unshare_table(dir);
+		page = *dir;
+	}
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
 	if ((3 & *(unsigned long *) page) == 1)  /* non-writeable, present */
@@ -287,7 +646,8 @@ void get_empty_page(unsigned long address)
  * task.
  *
  * NOTE! This assumes we have checked that p != current, and that they
- * share the same executable.
+ * share the same executable, and that share_page() has got us a
+ * writable page table to put the page in. Nothing here sleeps.
  */
 static int try_to_share(unsigned long address, struct task_struct * p)
 {
@@ -297,9 +657,11 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	unsigned long to_page;
 	unsigned long phys_addr;
 
-	from_page = to_page = ((address>>20) & 0xffc);
-	from_page += ((p->start_code>>20) & 0xffc);
+	to_page = ((address>>20) & 0xffc);
 	to_page += ((current->start_code>>20) & 0xffc);
+	to = *(unsigned long *) to_page;
+	from_page = ((address>>20) & 0xffc);
+	from_page += ((p->start_code>>20) & 0xffc);
 /* is there a page-directory at from? */
 	from = *(unsigned long *) from_page;
 	if (!(from & 1))
@@ -313,12 +675,6 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	phys_addr &= 0xfffff000;
 	if (phys_addr >= HIGH_MEMORY || phys_addr < LOW_MEM)
 		return 0;
-	to = *(unsigned long *) to_page;
-	if (!(to & 1))
-		if (to = get_free_page())
-			*(unsigned long *) to_page = to | 7;
-		else
-			oom();
 	to &= 0xfffff000;
 	to_page = to + ((address>>10) & 0xffc);
 	if (1 & *(unsigned long *) to_page)
@@ -333,81 +689,270 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	return 1;
 }
 
+/*
+ * Every executable inode keeps a list of the tasks running it, so that
+ * share_page() doesn't have to look through all of task[]. fork, exec
+ * and exit keep it up to date, before they touch i_count.
+ */
+void add_exec_task(struct task_struct * p)
+{
+	struct m_inode * inode = p->executable;
+
+	p->prev_exec = p->next_exec = NULL;
+	if (!inode)
+		return;
+	if (p->next_exec = inode->i_exec)
+		p->next_exec->prev_exec = p;
+	inode->i_exec = p;
+}
+
+void del_exec_task(struct task_struct * p)
+{
+	if (!p->executable)
+		return;
+	if (p->next_exec)
+		p->next_exec->prev_exec = p->prev_exec;
+	if (p->prev_exec)
+		p->prev_exec->next_exec = p->next_exec;
+	else
+		p->executable->i_exec = p->next_exec;
+	p->prev_exec = p->next_exec = NULL;
+}
+
 /*
  * share_page() tries to find a process that could share a page with
  * the current one. Address is the address of the wanted page relative
  * to the current data space.
  *
- * We first check if it is at all feasible by checking executable->i_count.
- * It should be >1 if there are other tasks sharing this inode.
+ * Only the tasks on the executable's list can have it. Our page table
+ * is seen to before the list is walked: getting it may sleep, and the
+ * tasks on the list may exit or exec meanwhile. Nothing sleeps during
+ * the walk.
  */
 static int share_page(unsigned long address)
 {
-	struct task_struct ** p;
+	struct task_struct * p;
+	unsigned long * to_page, to;
 
 	if (!current->executable)
 		return 0;
-	if (current->executable->i_count < 2)
+	p = current->executable->i_exec;
+	if (!p || (p == current && !p->next_exec))
 		return 0;
-	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
-		if (!*p)
-			continue;
-		if (current == *p)
-			continue;
-		if ((*p)->executable != current->executable)
+	to_page = (unsigned long *) (((address>>20) & 0xffc) +
+		((current->start_code>>20) & 0xffc));
+	if (!(*to_page & 1)) {
+		if (!(to = get_free_page()))
+			oom();
+		*to_page = to | 7;
+	} else if (!(*to_page & 2))
+		unshare_table(to_page);
+	for (p = current->executable->i_exec ; p ; p = p->next_exec) {
+		if (p == current)
 			continue;
-		if (try_to_share(address,*p))
+		if (try_to_share(address,p))
 			return 1;
 	}
 	return 0;
 }
 
+#ifndef FAULT_AROUND
+#define FAULT_AROUND 1
+#endif
+
+/*
+ * The blocks of the executable that hold the page at "tmp" (relative
+ * to the code start). Remember that 1 block is used for header.
+ */
+static void text_blocks(unsigned long tmp, int nr[4])
+{
+	int block, i;
+
+	block = 1 + tmp/BLOCK_SIZE;
+	for (i=0 ; i<4 ; block++,i++)
+		nr[i] = bmap(current->executable,block);
+}
+
+static void read_text_page(unsigned long page, unsigned long tmp, int nr[4])
+{
+	int i;
+
+	bread_page(page,current->executable->i_dev,nr);
+	i = tmp + 4096 - current->end_data;
+	tmp = page + 4096;
+	while (i-- > 0) {
+		tmp--;
+		*(char *)tmp = 0;
+	}
+}
+
+/*
+ * Is there nothing at all (not even a swapped-out page) at "address"?
+ */
+static int no_page(unsigned long address)
+{
+	unsigned long dir = *(unsigned long *) ((address>>20) & 0xffc);
+
+	if (!(dir & 1))
+		return 1;
+	return !((unsigned long *) (dir & 0xfffff000))[(address>>10) & 0x3ff];
+}
+
+/*
+ * Fault-around. Loading a program a page per fault means a fault, four
+ * bmap()s and a wait for the disk for every 4kB. Instead, the blocks
+ * of the next FAULT_AROUND-1 pages are read ahead along with those of
+ * the faulting one, and after it, any of those pages that can be had
+ * without waiting - from another task, or from the buffer cache - is
+ * mapped as well.
+ */
+static void read_around(unsigned long address, int nr[4])
+{
+	int blocks[4*FAULT_AROUND];
+	unsigned long tmp;
+	int i, n;
+
+	for (n = 0 ; n < 4 ; n++)
+		blocks[n] = nr[n];
+	for (i = 1 ; i < FAULT_AROUND ; i++) {
+		address += 4096;
+		tmp = address - current->start_code;
+		if (tmp >= current->end_data)
+			break;
+		if (!no_page(address))
+			continue;
+		text_blocks(tmp,blocks+n);
+		n += 4;
+	}
+	bread_ahead(current->executable->i_dev,blocks,n);
+}
+
+static void map_around(unsigned long address)
+{
+	unsigned long tmp, page;
+	int i, j, nr[4];
+
+	for (i = 1 ; i < FAULT_AROUND ; i++) {
+		address += 4096;
+		tmp = address - current->start_code;
+		if (tmp >= current->end_data)
+			break;
+		if (!no_page(address))
+			continue;
+		if (share_page(tmp))
+			continue;
+		text_blocks(tmp,nr);
+		for (j = 0 ; j < 4 ; j++)
+			if (nr[j] && !buffer_uptodate(
+			    current->executable->i_dev,nr[j]))
+				break;
+		if (j < 4)
+			continue;	/* still on its way */
+		if (!(page = get_pages(0)))
+			break;		/* don't swap for what isn't wanted yet */
+		read_text_page(page,tmp,nr);
+		if (!put_page(page,address)) {
+			free_page(page);
+			break;
+		}
+	}
+}
+
 void do_no_page(unsigned long error_code,unsigned long address)
 {
+	unsigned long * dir, * table_entry;
 	int nr[4];
 	unsigned long tmp;
 	unsigned long page;
-	int block,i;
 
 	address &= 0xfffff000;
+	dir = (unsigned long *) ((address>>20) & 0xffc);
+	if (*dir & 1) {
+		if (!(*dir & 2))
+			unshare_table(dir);
+		table_entry = (unsigned long *)
+			((0xfffff000 & *dir) + ((address>>10) & 0xffc));
+		if (*table_entry & 1)
+			return;		/* unshare_table() read it in */
+		if (*table_entry) {
+			swap_in(table_entry);
+			return;
+		}
+	}
 	tmp = address - current->start_code;
 	if (!current->executable || tmp >= current->end_data) {
-		get_empty_page(address);
+/* reading what was never written: share the zero page until a write */
+		if (error_code & 2)
+			get_empty_page(address);
+		else if (!put_shared_page((unsigned long) empty_zero_page,
+		    address))
+			oom();
 		return;
 	}
-	if (share_page(tmp))
+	if (share_page(tmp)) {
+		map_around(address);
 		return;
-	if (!(page = get_free_page()))
-		oom();
-/* remember that 1 block is used for header */
-	block = 1 + tmp/BLOCK_SIZE;
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(current->executable,block);
-	bread_page(page,current->executable->i_dev,nr);
-	i = tmp + 4096 - current->end_data;
-	tmp = page + 4096;
-	while (i-- > 0) {
-		tmp--;
-		*(char *)tmp = 0;
 	}
-	if (put_page(page,address))
+	if (!(page = __get_free_page()))
+		oom();
+	text_blocks(tmp,nr);
+	read_around(address,nr);
+	read_text_page(page,tmp,nr);
+	if (put_page(page,address)) {
+		map_around(address);
 		return;
+	}
 	free_page(page);
 	oom();
 }
 
+/*
+ * A 486 or better can be told to honour read-only pages in kernel mode
+ * too (CR0.WP). Then a put_fs_*() to a page that went read-only after
+ * verify_area() - merge.c does that from the idle task - faults into
+ * do_wp_page() just like a user write. The 386 has no such bit, and is
+ * told apart by the AC flag, which it can't set.
+ */
+static void enable_wp(void)
+{
+	unsigned long f1, f2;
+
+	__asm__("pushfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"movl %0,%1\n\t"
+		"xorl $0x40000,%0\n\t"
+		"pushl %0\n\t"
+		"popfl\n\t"
+		"pushfl\n\t"
+		"popl %0\n\t"
+		"popfl"
+		:"=&r" (f1),"=&r" (f2));
+	if (!((f1 ^ f2) & 0x40000))
+		return;
+	__asm__("movl %%cr0,%0\n\t"
+		"orl $0x10000,%0\n\t"
+		"movl %0,%%cr0"
+		:"=&r" (f1));
+}
+
 void mem_init(long start_mem, long end_mem)
 {
 	int i;
 
+	enable_wp();
 	HIGH_MEMORY = end_mem;
+	for (i=0 ; i<MAX_ORDER ; i++)
+		free_area[i].next = free_area[i].prev = free_area + i;
 	for (i=0 ; i<PAGING_PAGES ; i++)
 		mem_map[i] = USED;
 	i = MAP_NR(start_mem);
 	end_mem -= start_mem;
 	end_mem >>= 12;
-	while (end_mem-->0)
-		mem_map[i++]=0;
+	while (end_mem-->0) {
+		mem_map[i]=0;
+		free_pages_block(i++,0);
+	}
 }
 
 void calc_mem(void)
@@ -418,6 +963,11 @@ void calc_mem(void)
 	for(i=0 ; i<PAGING_PAGES ; i++)
 		if (!mem_map[i]) free++;
 	printk("%d pages free (of %d)\n\r",free,PAGING_PAGES);
+	for (i=0 ; i<MAX_ORDER ; i++)
+		printk("%d ",nr_free[i]);
+	printk("free blocks of 1..%d pages\n\r",1<<(MAX_ORDER-1));
+	printk("%d pre-zeroed pages\n\r",nr_zero);
+	printk("%d pages merged\n\r",nr_merged);
 	for(i=2 ; i<1024 ; i++) {
 		if (1&pg_dir[i]) {
 			pg_tbl=(long *) (0xfffff000 & pg_dir[i]);
@@ -0,0 +1,170 @@
+/*
+ *  linux/mm/merge.c
+ *
+ * Same-page merging. Lots of copies of the same shell end up with
+ * lots of private pages that are identical: after fork and copy-on-
+ * write, every one of them has its own copy of the same heap and the
+ * same stack. The idle task walks the user page tables a few pages at
+ * a time, hashes the dirty (anonymous) pages, and where two of them
+ * have the same contents, maps both to one of them, read-only, with
+ * the other freed. A write to it goes through do_wp_page() like any
+ * other shared page, and gets its private copy back. Pages that are
+ * all zeroes go to the zero page instead.
+ *
+ * A page is only offered for merging once its hash has stayed the
+ * same over a whole pass: pages that are being written to would just
+ * keep faulting. It is write-protected then, so its contents can't
+ * change under a later merge without its table entry showing it.
+ *
+ * The owner may be asleep in a system call, between verify_area() and
+ * writing to the page. That write has to fault too, so this only runs
+ * when mem_init() could set CR0.WP: not on a 386.
+ */
+
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/head.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+
+#define FIRST_VM_PAGE (0x4000000>>12)	/* task 0 is left alone */
+
+#define PAGES_TO_SCAN 16		/* per idle call */
+#define NR_MERGE_HASH 256
+
+/*
+ * Candidates are kept by linear address, not by table entry: fork and
+ * unshare_table() move page tables around, addresses stay put.
+ */
+static struct merge_entry {
+	unsigned long hash;
+	unsigned long address;
+} merge_hash[NR_MERGE_HASH];
+
+/* the hash each page had on the last pass, indexed by MAP_NR() */
+static unsigned short page_sum [ PAGING_PAGES ];
+
+int nr_merged = 0;
+
+static unsigned long hash_page(unsigned long page)
+{
+	unsigned long * p = (unsigned long *) page;
+	unsigned long hash = 0;
+	int i;
+
+	for (i = 0 ; i < 1024 ; i++)
+		hash = (hash << 5) + hash + (hash >> 27) + *p++;
+	return hash ? hash : 1;		/* so a page of zeroes hashes to 1 */
+}
+
+static unsigned long * get_table_entry(unsigned long address)
+{
+	unsigned long dir;
+
+	dir = pg_dir[address>>22];
+	if (!(dir & PAGE_PRESENT))
+		return NULL;
+	return ((address>>10) & 0xffc) + (unsigned long *) (dir & 0xfffff000);
+}
+
+/*
+ * Is the candidate at "address" still a present, write-protected page
+ * with the same contents as "page"? Then "page" can go.
+ */
+static unsigned long find_twin(unsigned long address, unsigned long page)
+{
+	unsigned long * table_ptr, twin;
+
+	if (!(table_ptr = get_table_entry(address)))
+		return 0;
+	twin = *table_ptr;
+	if ((twin & (PAGE_PRESENT | PAGE_RW)) != PAGE_PRESENT)
+		return 0;
+	twin &= 0xfffff000;
+	if (twin == page || twin - LOW_MEM >= PAGING_MEMORY)
+		return 0;
+	if (!mem_map[MAP_NR(twin)] || twin == vtime_page)
+		return 0;
+	if (memcmp((void *) twin,(void *) page,4096))
+		return 0;
+	return twin;
+}
+
+static void merge_one(unsigned long * table_ptr, unsigned long address)
+{
+	struct merge_entry * entry;
+	unsigned long page, hash, twin;
+
+	page = *table_ptr;
+	if ((page & (PAGE_PRESENT | PAGE_DIRTY)) != (PAGE_PRESENT | PAGE_DIRTY))
+		return;
+	page &= 0xfffff000;
+	if (page - LOW_MEM >= PAGING_MEMORY || page == vtime_page)
+		return;
+	hash = hash_page(page);
+	if (hash == 1 && !memcmp((void *) page,empty_zero_page,4096)) {
+		*table_ptr = (unsigned long) empty_zero_page |
+			(*table_ptr & 0xfff & ~(PAGE_RW | PAGE_DIRTY));
+		invalidate();
+		free_page(page);
+		nr_merged++;
+		return;
+	}
+	entry = merge_hash + hash % NR_MERGE_HASH;
+	if (entry->hash == hash && (twin = find_twin(entry->address,page))) {
+		mem_map[MAP_NR(twin)]++;
+		*table_ptr = twin | (*table_ptr & 0xfff & ~PAGE_RW);
+		invalidate();
+		free_page(page);
+		nr_merged++;
+		return;
+	}
+	if (page_sum[MAP_NR(page)] != (unsigned short) hash) {
+		page_sum[MAP_NR(page)] = hash;	/* still changing */
+		return;
+	}
+	if (*table_ptr & PAGE_RW) {
+		*table_ptr &= ~PAGE_RW;
+		invalidate();
+	}
+	entry->hash = hash;
+	entry->address = address;
+}
+
+/*
+ * Called by the idle task. Like swap_out() this is a clock over the
+ * user page tables, and tables fork shares between tasks are skipped:
+ * their pages are shared already.
+ */
+void merge_pages(void)
+{
+	static int dir_entry = FIRST_VM_PAGE>>10;
+	static int page_entry = -1;
+	int counter = PAGES_TO_SCAN;
+	unsigned long * pg_table, cr0;
+
+	__asm__("movl %%cr0,%0":"=r" (cr0));
+	if (!(cr0 & 0x10000))
+		return;			/* no CR0.WP, see above */
+	while (counter > 0) {
+		pg_table = (unsigned long *) (0xfffff000 & pg_dir[dir_entry]);
+		if ((pg_dir[dir_entry] & (PAGE_PRESENT | PAGE_RW)) ==
+		    (PAGE_PRESENT | PAGE_RW)) {
+			while (++page_entry < 1024) {
+				if (!(PAGE_PRESENT & pg_table[page_entry]))
+					continue;
+				merge_one(pg_table + page_entry,
+				    (dir_entry<<22) + (page_entry<<12));
+				if (--counter <= 0)
+					return;
+			}
+		}
+		page_entry = -1;
+		if (++dir_entry >= 1024) {
+			dir_entry = FIRST_VM_PAGE>>10;
+			return;
+		}
+	}
+}
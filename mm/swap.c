@@ -0,0 +1,455 @@
+/*
+ *  linux/mm/swap.c
+ *
+ * Paging to a swap partition. A swapped-out page leaves its swap page
+ * number (shifted left one, so the present bit stays clear) in the
+ * page table entry; do_no_page() sees a non-zero entry and reads it
+ * back with swap_in().
+ *
+ * The partition is prepared by mkswap: page 0 holds a bitmap of the
+ * usable pages, and ends in the signature "SWAP-SPACE". Only one swap
+ * device is supported.
+ *
+ * Before that, pages are tried in a compressed store in memory (see
+ * ZSWAP_PAGES in <linux/config.h>). Its entries are numbered from
+ * SWAP_BITS up, past any page of the partition.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/head.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <asm/system.h>
+
+volatile void do_exit(long code);
+
+#define SWAP_BITS (4096<<3)
+
+#define FIRST_VM_PAGE (0x4000000>>12)	/* task 0 is never swapped */
+#define LAST_VM_PAGE (1024*1024)
+#define VM_PAGES (LAST_VM_PAGE - FIRST_VM_PAGE)
+
+#define bitop(name,op) \
+static inline int name(char * addr,unsigned int nr) \
+{ \
+int __res; \
+__asm__ __volatile__("bt" op " %1,%2; adcl $0,%0" \
+	:"=g" (__res) \
+	:"r" (nr),"m" (*(addr)),"0" (0)); \
+return __res; \
+}
+
+bitop(bit,"")
+bitop(setbit,"s")
+bitop(clrbit,"r")
+
+static char * swap_bitmap = NULL;
+static int swap_dev = 0;
+
+/*
+ * All swap i/o goes through this, one page at a time: a page being
+ * written out can't be read back in before the write is done.
+ */
+static struct mutex swap_mutex = MUTEX_INIT;
+
+#define read_swap_page(nr,buffer) ll_rw_page(READ,swap_dev,(nr),(buffer))
+#define write_swap_page(nr,buffer) ll_rw_page(WRITE,swap_dev,(nr),(buffer))
+
+/*
+ * Swap pages that couldn't be written. What they should hold is lost,
+ * so reading one back fails, and freeing one doesn't give it back to
+ * the bitmap: the sector is probably bad.
+ */
+#define NR_BAD_SWAP 32
+
+static unsigned long bad_swap[NR_BAD_SWAP];
+
+static int find_bad_swap(unsigned long nr)
+{
+	int i;
+
+	for (i = 0 ; i < NR_BAD_SWAP ; i++)
+		if (bad_swap[i] == nr)
+			return i;
+	return -1;
+}
+
+#ifdef ZSWAP_PAGES
+/*
+ * The compressed store: pages of 8 units of 512 bytes, 'zused' saying
+ * which units are taken. A compressed page gets a slot, which says
+ * where its units are. Nothing here sleeps.
+ *
+ * Compression is run-length coding of 32-bit words - crude, but the
+ * anonymous pages of idle programs are mostly zeroes and repeats, and
+ * it costs next to nothing. A control byte with the top bit set is a
+ * run of (c&0x7f)+1 copies of the word that follows, else c+1 literal
+ * words follow. Pages that don't shrink to 6 units or less aren't
+ * worth it.
+ */
+#define ZUNIT		512
+#define ZUNITS		(4096/ZUNIT)
+#define ZMAX		(6*ZUNIT)
+#define NR_ZSLOTS	(ZSWAP_PAGES*ZUNITS)
+
+struct zslot {
+	unsigned short store;
+	unsigned char unit, nunits;	/* nunits == 0: free slot */
+};
+
+static unsigned long zstore[ZSWAP_PAGES];
+static unsigned char zused[ZSWAP_PAGES];
+static struct zslot zslot[NR_ZSLOTS];
+static unsigned char zbuf[ZMAX+8];
+static int nr_zpages = 0, nr_zstored = 0;
+
+static int zcompress(unsigned long * from, unsigned char * to)
+{
+	unsigned char * p = to;
+	int i = 0, j, n;
+
+	while (i < 1024) {
+		for (n = 1 ; i+n < 1024 && n < 128 ; n++)
+			if (from[i+n] != from[i])
+				break;
+		if (n > 1) {
+			if (p + 5 > to + ZMAX)
+				return 0;
+			*p++ = 0x80 | (n-1);
+			*(unsigned long *) p = from[i];
+			p += 4;
+			i += n;
+			continue;
+		}
+		for (n = 1 ; i+n < 1024 && n < 128 ; n++)
+			if (i+n+1 < 1024 && from[i+n] == from[i+n+1])
+				break;
+		if (p + 1 + 4*n > to + ZMAX)
+			return 0;
+		*p++ = n-1;
+		for (j = 0 ; j < n ; j++, p += 4)
+			*(unsigned long *) p = from[i+j];
+		i += n;
+	}
+	return p - to;
+}
+
+static void zdecompress(unsigned char * from, unsigned long * to)
+{
+	unsigned long * end = to + 1024;
+	int n;
+
+	while (to < end) {
+		n = (*from & 0x7f) + 1;
+		if (*from++ & 0x80) {
+			while (n--)
+				*to++ = *(unsigned long *) from;
+			from += 4;
+		} else
+			while (n--) {
+				*to++ = *(unsigned long *) from;
+				from += 4;
+			}
+	}
+}
+
+/*
+ * Compress 'page' into the store. Returns its swap page number, or 0.
+ * If no store page has room, 'page' itself becomes one and '*keep' is
+ * set: then it must not be freed.
+ */
+static unsigned long zswap_store(unsigned long page, int * keep)
+{
+	int len, n, slot, s, u;
+	unsigned char mask;
+
+	*keep = 0;
+	if (!(len = zcompress((unsigned long *) page,zbuf)))
+		return 0;
+	n = (len + ZUNIT-1) / ZUNIT;
+	mask = (1<<n) - 1;
+	for (slot = 0 ; slot < NR_ZSLOTS ; slot++)
+		if (!zslot[slot].nunits)
+			break;
+	if (slot >= NR_ZSLOTS)
+		return 0;
+	for (s = 0 ; s < ZSWAP_PAGES ; s++) {
+		if (!zstore[s])
+			continue;
+		for (u = 0 ; u + n <= ZUNITS ; u++)
+			if (!(zused[s] & (mask << u)))
+				goto found;
+	}
+	for (s = 0 ; s < ZSWAP_PAGES ; s++)
+		if (!zstore[s])
+			break;
+	if (s >= ZSWAP_PAGES)
+		return 0;
+	zstore[s] = page;
+	zused[s] = 0;
+	nr_zpages++;
+	*keep = 1;
+	u = 0;
+found:
+	zused[s] |= mask << u;
+	zslot[slot].store = s;
+	zslot[slot].unit = u;
+	zslot[slot].nunits = n;
+	memcpy((char *) zstore[s] + u*ZUNIT,zbuf,len);
+	nr_zstored++;
+	return SWAP_BITS + slot;
+}
+
+static void zswap_load(unsigned long nr, unsigned long page)
+{
+	struct zslot * z = zslot + (nr - SWAP_BITS);
+
+	zdecompress((unsigned char *) zstore[z->store] + z->unit*ZUNIT,
+		(unsigned long *) page);
+}
+
+static void zswap_free(unsigned long nr)
+{
+	struct zslot * z = zslot + (nr - SWAP_BITS);
+	int s = z->store;
+
+	zused[s] &= ~(((1 << z->nunits) - 1) << z->unit);
+	z->nunits = 0;
+	nr_zstored--;
+	if (!zused[s]) {
+		free_page(zstore[s]);
+		zstore[s] = 0;
+		nr_zpages--;
+	}
+}
+
+#define is_zswap(nr) ((nr) >= SWAP_BITS && (nr) < SWAP_BITS + NR_ZSLOTS)
+#else
+#define is_zswap(nr) 0
+#define zswap_load(nr,page)
+#define zswap_free(nr)
+#endif
+
+static unsigned long get_swap_page(void)
+{
+	static unsigned long last = 0;
+	unsigned long nr;
+
+	if (!swap_bitmap)
+		return 0;
+	for (nr = (last+1) % SWAP_BITS ; nr != last ; nr = (nr+1) % SWAP_BITS)
+		if (nr && clrbit(swap_bitmap,nr))
+			return last = nr;
+	return 0;
+}
+
+void swap_free(unsigned long entry)
+{
+	unsigned long nr = entry >> 1;
+	int i;
+
+	if (!nr)
+		return;
+	if (is_zswap(nr)) {
+		zswap_free(nr);
+		return;
+	}
+	if ((i = find_bad_swap(nr)) >= 0) {
+		bad_swap[i] = 0;
+		return;
+	}
+	if (swap_bitmap && nr < SWAP_BITS)
+		if (!setbit(swap_bitmap,nr))
+			return;
+	printk("swap_free: swap-space bitmap bad (%d)\n\r",nr);
+}
+
+/*
+ * Read the page behind a swap entry into 'page', leaving the entry (and
+ * its swap page) alone. unshare_table() uses this when a shared table
+ * holds one. Returns 0, or -EIO if the page can't be had: the callers
+ * then kill the task with SIGBUS.
+ */
+int swap_copy(unsigned long entry, unsigned long page)
+{
+	int error;
+
+	if (is_zswap(entry >> 1)) {
+		zswap_load(entry >> 1,page);
+		return 0;
+	}
+	if (!swap_bitmap) {
+		printk("Trying to swap in without swap bitmap\n\r");
+		return -EIO;
+	}
+	if (find_bad_swap(entry >> 1) >= 0)
+		return -EIO;
+	mutex_lock(&swap_mutex);
+	error = read_swap_page(entry >> 1,(char *) page);
+	mutex_unlock(&swap_mutex);
+	if (error)
+		printk("swap_copy: can't read swap page %d\n\r",entry >> 1);
+	return error;
+}
+
+void swap_in(unsigned long * table_ptr)
+{
+	unsigned long entry, page;
+
+	entry = *table_ptr;
+	if (!(page = __get_free_page()))
+		oom();
+	if (swap_copy(entry,page)) {
+		free_page(page);
+		do_exit(SIGBUS);
+	}
+	if (*table_ptr != entry) {	/* can't happen, but... */
+		free_page(page);
+		return;
+	}
+	swap_free(entry);
+	*table_ptr = page | (PAGE_DIRTY | 7);
+}
+
+/*
+ * Clean pages are simply dropped: they are either still in the
+ * executable or were never written to, and do_no_page() knows how to
+ * get them back. Dirty ones go to swap if nobody else has them.
+ */
+static int try_to_swap_out(unsigned long * table_ptr)
+{
+	unsigned long page, nr;
+	int i;
+#ifdef ZSWAP_PAGES
+	int keep;
+#endif
+
+	page = *table_ptr;
+	if (!(PAGE_PRESENT & page))
+		return 0;
+	if ((page & 0xfffff000) - LOW_MEM >= PAGING_MEMORY)
+		return 0;
+	if ((page & 0xfffff000) == vtime_page)
+		return 0;
+	if (PAGE_ACCESSED & page) {	/* used lately: give it another round */
+		*table_ptr = page & ~PAGE_ACCESSED;
+		return 0;
+	}
+	if (!(PAGE_DIRTY & page)) {
+		*table_ptr = 0;
+		invalidate();
+		free_page(page & 0xfffff000);
+		return 1;
+	}
+	if (mem_map[MAP_NR(page & 0xfffff000)] != 1)
+		return 0;
+#ifdef ZSWAP_PAGES
+	if ((nr = zswap_store(page & 0xfffff000,&keep)) != 0) {
+		*table_ptr = nr << 1;
+		invalidate();
+		if (!keep)
+			free_page(page & 0xfffff000);
+		return 1;
+	}
+#endif
+	if (mutex_locked(&swap_mutex))	/* don't sleep with table_ptr */
+		return 0;
+	if (!(nr = get_swap_page()))
+		return 0;
+	mutex_lock(&swap_mutex);
+	*table_ptr = nr << 1;
+	invalidate();
+	if (write_swap_page(nr,(char *) (page & 0xfffff000))) {
+		printk("swap_out: can't write swap page %d\n\r",nr);
+		if ((i = find_bad_swap(0)) < 0)
+			panic("swap_out: too many bad swap pages");
+		bad_swap[i] = nr;
+	}
+	mutex_unlock(&swap_mutex);
+	free_page(page & 0xfffff000);
+	return 1;
+}
+
+/*
+ * A clock over all user page tables, starting where the last call
+ * stopped. The accessed bit gives every page a second chance, so what
+ * goes is (roughly) the least recently used. Tables that fork shares
+ * between tasks are left alone.
+ */
+int swap_out(void)
+{
+	static int dir_entry = FIRST_VM_PAGE>>10;
+	static int page_entry = -1;
+	int counter = 2 * VM_PAGES;
+	unsigned long pg_table;
+
+	while (counter > 0) {
+		pg_table = pg_dir[dir_entry];
+		if ((pg_table & (PAGE_PRESENT | PAGE_RW)) ==
+		    (PAGE_PRESENT | PAGE_RW)) {
+			while (++page_entry < 1024) {
+				counter--;
+				if (try_to_swap_out(page_entry +
+				    (unsigned long *) (pg_table & 0xfffff000)))
+					return 1;
+			}
+		} else
+			counter -= 1024 - (page_entry+1);
+		page_entry = -1;
+		if (++dir_entry >= 1024)
+			dir_entry = FIRST_VM_PAGE>>10;
+	}
+	return 0;
+}
+
+int sys_swapon(const char * specialfile)
+{
+	struct m_inode * inode;
+	char * bitmap;
+	int i, j, dev;
+
+	if (!suser())
+		return -EPERM;
+	if (swap_bitmap)
+		return -EBUSY;
+	if (!(inode = namei(specialfile)))
+		return -ENOENT;
+	if (!S_ISBLK(inode->i_mode)) {
+		iput(inode);
+		return -ENOTBLK;
+	}
+	dev = inode->i_zone[0];
+	iput(inode);
+	if (MAJOR(dev) == 2)		/* floppies do 1kB per request only */
+		return -EINVAL;
+	if (!(bitmap = (char *) get_free_page()))
+		return -ENOMEM;
+	if (ll_rw_page(READ,dev,0,bitmap)) {
+		free_page((long) bitmap);
+		return -EIO;
+	}
+	if (strncmp("SWAP-SPACE",bitmap+4086,10)) {
+		printk("Unable to find swap-space signature\n\r");
+		free_page((long) bitmap);
+		return -EINVAL;
+	}
+	memset(bitmap+4086,0,10);
+	clrbit(bitmap,0);		/* the header itself */
+	for (i = j = 0 ; i < SWAP_BITS ; i++)
+		if (bit(bitmap,i))
+			j++;
+	if (!j) {
+		free_page((long) bitmap);
+		return -EINVAL;
+	}
+	swap_dev = dev;
+	swap_bitmap = bitmap;
+	printk("Adding swap: %d pages (%d bytes) swap-space\n\r",j,j*4096);
+	return 0;
+}
@@ -20,6 +20,11 @@
  * Changes by tytso to allow root device specification
  */
 
+/*
+ * The scheduler mode (COUNTER or FAIR) can be given after the root
+ * device. It ends up in the word at offset 506 of the boot-sector.
+ */
+
 #include <stdio.h>	/* fprintf */
 #include <string.h>
 #include <stdlib.h>	/* contains exit */
@@ -51,7 +56,7 @@ void die(char * str)
 
 void usage(void)
 {
-	die("Usage: build bootsect setup system [rootdev] [> image]");
+	die("Usage: build bootsect setup system [rootdev] [schedmode] [> image]");
 }
 
 int main(int argc, char ** argv)
@@ -59,8 +64,14 @@ int main(int argc, char ** argv)
 	int i,c,id;
 	char buf[1024];
 	char major_root, minor_root;
+	char sched_mode = 0;
 	struct stat sb;
 
+	if (argc > 4 && !strcmp(argv[argc-1], "FAIR")) {
+		sched_mode = 1;
+		argc--;
+	} else if (argc > 4 && !strcmp(argv[argc-1], "COUNTER"))
+		argc--;
 	if ((argc != 4) && (argc != 5))
 		usage();
 	if (argc == 5) {
@@ -80,6 +91,7 @@ int main(int argc, char ** argv)
 		minor_root = DEFAULT_MINOR_ROOT;
 	}
 	fprintf(stderr, "Root device is (%d, %d)\n", major_root, minor_root);
+	fprintf(stderr, "Scheduler is %s\n", sched_mode ? "fair" : "counter");
 	if ((major_root != 2) && (major_root != 3) &&
 	    (major_root != 0)) {
 		fprintf(stderr, "Illegal root device (major = %d)\n",
@@ -109,6 +121,8 @@ int main(int argc, char ** argv)
 		die("Boot block must be exactly 512 bytes");
 	if ((*(unsigned short *)(buf+510)) != 0xAA55)
 		die("Boot block hasn't got boot flag (0xAA55)");
+	buf[506] = sched_mode;
+	buf[507] = 0;
 	buf[508] = (char) minor_root;
 	buf[509] = (char) major_root;	
 	i=write(1,buf,512);